@@ -2,6 +2,7 @@ import numpy
 from typing import ClassVar
 
 b8: Dtype
+cpu0: Device
 device0: Device
 f16: Dtype
 f32: Dtype
@@ -34,7 +35,8 @@ class Array:
     def is_contiguous(self) -> bool: ...
     def itemsize(self) -> int: ...
     def log(self, in_place: bool = ...) -> Array: ...
-    def max(self, dims: list[int] = ...) -> Array: ...
+    def max(self, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
+    def min(self, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
     def nbytes(self) -> int: ...
     def ndim(self) -> int: ...
     def neg(self, in_place: bool = ...) -> Array: ...
@@ -46,15 +48,19 @@ class Array:
     @staticmethod
     def ones_like(arr: Array, device: Device = ..., constant: bool = ...) -> Array: ...
     def permute(self, order: list[int]) -> Array: ...
+    @staticmethod
+    def placeholder(view: list[int], dtype: Dtype = ..., device: Device = ...) -> Array: ...
     def ptr(self) -> int: ...
     def recip(self, in_place: bool = ...) -> Array: ...
+    def requires_grad(self) -> bool: ...
     def reshape(self, view: list[int]) -> Array: ...
+    def set_requires_grad(self, requires_grad: bool) -> None: ...
     def shape(self) -> Shape: ...
     def sq(self, in_place: bool = ...) -> Array: ...
     def sqrt(self, in_place: bool = ...) -> Array: ...
     def stride(self) -> list[int]: ...
     def strided_idx(self, k: int) -> int: ...
-    def sum(self, dims: list[int] = ...) -> Array: ...
+    def sum(self, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
     def view(self) -> list[int]: ...
     @staticmethod
     def zeros(view: list[int], dtype: Dtype = ..., device: Device = ..., constant: bool = ...) -> Array: ...
@@ -84,9 +90,18 @@ class Array:
     @property
     def grad(self) -> Array: ...
 
+class CPUContext:
+    def __init__(self) -> None: ...
+
+class CPUGraph(Graph):
+    def __init__(self, root: Array, ctx: CPUContext) -> None: ...
+
 class Device:
     def __init__(self, *args, **kwargs) -> None: ...
+    def empty_cache(self) -> None: ...
     def idx(self) -> int: ...
+    def memory_allocated(self) -> int: ...
+    def memory_reserved(self) -> int: ...
     def type(self) -> DeviceType: ...
     def __eq__(self, arg0: Device) -> bool: ...
     def __neq__(self, arg0: Device) -> bool: ...
@@ -115,12 +130,28 @@ class Dtype:
     def __hash__(self) -> int: ...
     def __neq__(self, dtype: Dtype) -> bool: ...
 
+class Future:
+    def __init__(self, *args, **kwargs) -> None: ...
+    def done(self) -> bool: ...
+    def wait(self) -> None: ...
+
 class Graph:
     def __init__(self, *args, **kwargs) -> None: ...
     def backward(self) -> None: ...
-    def compile(self) -> None: ...
+    def backward_async(self) -> Future: ...
+    def compile(self, plan_memory: bool = ..., fuse: bool = ..., simplify: bool = ..., inference: bool = ..., cache: bool = ...) -> None: ...
     def forward(self) -> None: ...
+    def forward_async(self) -> Future: ...
+    def naive_nbytes(self) -> int: ...
+    def num_fused(self) -> int: ...
+    def num_merged(self) -> int: ...
+    def num_folded(self) -> int: ...
+    def num_simplified(self) -> int: ...
+    def simplified_nbytes(self) -> int: ...
+    def planned_nbytes(self) -> int: ...
     def root(self) -> Array: ...
+    def run(self, inputs: dict[Array, Array | numpy.ndarray]) -> None: ...
+    def wait(self) -> None: ...
 
 class Id:
     def __init__(self, *args, **kwargs) -> None: ...
@@ -156,18 +187,23 @@ class Shape:
 
 def T(arr: object, start_dim: int = ..., end_dim: int = ...) -> Array: ...
 def add(lhs: object, rhs: object) -> Array: ...
+def clear_plan_cache() -> None: ...
 def div(lhs: object, rhs: object) -> Array: ...
 def eq(lhs: object, rhs: object) -> Array: ...
 def exp(arr: object, in_place: bool = ...) -> Array: ...
 def flatten(arr: object, start_dim: int = ..., end_dim: int = ...) -> Array: ...
 def geq(lhs: object, rhs: object) -> Array: ...
+def get_num_workers() -> int: ...
+def get_plan_cache_hits() -> int: ...
+def get_plan_cache_misses() -> int: ...
 def gt(lhs: object, rhs: object) -> Array: ...
 def identity(arg0: object) -> Array: ...
 def leq(lhs: object, rhs: object) -> Array: ...
 def log(arr: object, in_place: bool = ...) -> Array: ...
 def lt(lhs: object, rhs: object) -> Array: ...
 def matmul(lhs: object, rhs: object) -> Array: ...
-def max(arr: object, dims: list[int] = ...) -> Array: ...
+def max(arr: object, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
+def min(arr: object, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
 def mul(lhs: object, rhs: object) -> Array: ...
 def neg(arr: object, in_place: bool = ...) -> Array: ...
 def neq(lhs: object, rhs: object) -> Array: ...
@@ -177,7 +213,9 @@ def self_add(lhs: object, rhs: object) -> Array: ...
 def self_div(lhs: object, rhs: object) -> Array: ...
 def self_mul(lhs: object, rhs: object) -> Array: ...
 def self_sub(lhs: object, rhs: object) -> Array: ...
+def set_num_workers(num_workers: int) -> None: ...
+def set_plan_cache_capacity(capacity: int) -> None: ...
 def sq(arr: object, in_place: bool = ...) -> Array: ...
 def sqrt(arr: object, in_place: bool = ...) -> Array: ...
 def sub(lhs: object, rhs: object) -> Array: ...
-def sum(arr: object, dims: list[int] = ...) -> Array: ...
+def sum(arr: object, dims: list[int] = ..., keepdim: bool = ...) -> Array: ...
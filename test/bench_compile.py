@@ -0,0 +1,41 @@
+"""Times graph compilation on long chains of elementwise operations.
+
+Run with `python -m test.bench_compile [max_nodes]`. Compile time per node should stay flat as the chain grows.
+"""
+import sys
+import time
+
+import numpy as np
+from python.xavier import Array, CPUContext, CPUGraph, cpu0
+
+
+def build_chain(num_nodes):
+    arr1 = Array.from_numpy(np.full(16, 0.5, dtype=np.float32), device=cpu0)
+    arr2 = arr1
+    for i in range(num_nodes):
+        if i % 3 == 0:
+            arr2 = arr2 + arr1
+        elif i % 3 == 1:
+            arr2 = arr2 * arr1
+        else:
+            arr2 = arr2 - arr1
+    return arr2.sum()
+
+
+def main():
+    max_nodes = int(sys.argv[1]) if len(sys.argv) > 1 else 10**6
+    ctx = CPUContext()
+    for num_nodes in [10**4, 10**5, 10**6]:
+        if num_nodes > max_nodes:
+            break
+        for options in [{}, {"plan_memory": True}, {"fuse": True}]:
+            # Each graph gets its own chain, since compiling may allocate the buffers of its arrays
+            g = CPUGraph(build_chain(num_nodes), ctx)
+            start = time.perf_counter()
+            g.compile(**options)
+            elapsed = time.perf_counter() - start
+            print(f"{num_nodes:>8} nodes {str(options):<22} compile {elapsed * 1e3:10.1f} ms {elapsed * 1e6 / num_nodes:8.2f} us/node")
+
+
+if __name__ == "__main__":
+    main()
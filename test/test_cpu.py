@@ -0,0 +1,784 @@
+import threading
+
+import numpy as np
+import pytest
+import torch
+from python.xavier import Array, CPUContext, CPUGraph, clear_plan_cache, cpu0, get_num_workers, get_plan_cache_hits, get_plan_cache_misses, i32, self_add, set_num_workers
+
+
+class TestCPU:
+    def setup_method(self):
+        self.ctx = CPUContext()
+
+    def test_cpu_elementwise(self):
+        """Test unary and binary operations on the CPU backend"""
+        print("\nTesting CPU element-wise operations:")
+        shapes = [[1], [7, 3], [4, 5, 6], [2, 3, 4, 5]]
+
+        for shape in shapes:
+            np1 = np.random.randn(*shape).astype(np.float32)
+            np2 = np.random.rand(*shape).astype(np.float32) + 0.5
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = Array.from_numpy(np2, device=cpu0)
+            arr3 = ((arr1 + arr2) * arr1 - arr2.sqrt()) / arr2
+            arr4 = arr3.exp().neg() + arr2.log() * arr2.recip() + arr1.sq()
+            arr5 = arr4.sum()
+            g = CPUGraph(arr5, self.ctx)
+            g.compile()
+            g.forward()
+
+            t1 = torch.from_numpy(np1)
+            t2 = torch.from_numpy(np2)
+            t3 = ((t1 + t2) * t1 - t2.sqrt()) / t2
+            t4 = -t3.exp() + t2.log() * t2.reciprocal() + t1.square()
+            assert np.allclose(arr4.numpy(), t4.numpy(), atol=1e-3, rtol=1e-4)
+            assert np.allclose(arr5.numpy(), t4.sum().numpy(), atol=1e-2, rtol=1e-4)
+
+    def test_cpu_unary_strided(self):
+        """Test unary operations on transposed and sliced inputs with lengths that leave vector tails"""
+        print("\nTesting CPU unary operations on strided inputs:")
+        shapes = [[5, 37], [3, 17, 19], [64, 33]]
+
+        for shape in shapes:
+            np1 = np.random.rand(*shape).astype(np.float32) + 0.1
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = arr1.T(0)
+            arr3 = arr1[::2, 1:]
+            arr4 = arr2.exp() + arr2.log()
+            arr5 = arr3.sqrt() * arr3.recip()
+            arr6 = arr4.sum() + arr5.sum()
+            g = CPUGraph(arr6, self.ctx)
+            g.compile()
+            g.forward()
+
+            t1 = torch.from_numpy(np1)
+            t2 = t1.transpose(0, -1)
+            t3 = t1[::2, 1:]
+            assert np.allclose(arr4.numpy(), (t2.exp() + t2.log()).numpy(), atol=1e-3, rtol=1e-4)
+            assert np.allclose(arr5.numpy(), (t3.sqrt() * t3.reciprocal()).numpy(), atol=1e-3, rtol=1e-4)
+
+    def test_cpu_exp_log_subnormal(self):
+        """Test that exp and log agree between the vector body and the scalar tail around subnormal floats"""
+        print("\nTesting CPU exp and log near subnormals:")
+        np1 = np.array([-80.0, -87.5, -88.0, -95.0, -100.0, -103.0, -104.0, 88.5, 0.0], dtype=np.float32)
+        np2 = np.array([1e-38, 1e-40, 1e-42, 1e-45, 3e-39, 1.0, 2.0, 0.5, 1e30], dtype=np.float32)
+        # Each value lands in the vector body and, as the lengths are not multiples of the vector width, in the tail
+        np1 = np.tile(np1, 5)
+        np2 = np.tile(np2, 5)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        arr3 = arr1.exp()
+        arr4 = arr2.log()
+        g = CPUGraph(arr3.sum() + arr4.sum(), self.ctx)
+        g.compile()
+        g.forward()
+
+        assert np.allclose(arr3.numpy(), np.exp(np1.astype(np.float64)).astype(np.float32), rtol=1e-6, atol=3e-45)
+        assert np.allclose(arr4.numpy(), np.log(np2.astype(np.float64)).astype(np.float32), rtol=1e-6)
+
+    def test_cpu_strided_copy(self):
+        """Test copies and printing of permuted and sliced arrays that mix mergeable and non-mergeable dimensions"""
+        print("\nTesting CPU strided copies:")
+        np1 = np.random.randn(4, 6, 5, 3).astype(np.float32)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = arr1.permute([2, 0, 1, 3])[:, 1:, ::2]
+        arr3 = arr2.reshape([5, 27])
+        arr4 = arr2.exp() + arr2
+        arr5 = arr2 + 0.0
+        arr6 = arr3.sum() + arr4.sum() + arr5.sum()
+        g = CPUGraph(arr6, self.ctx)
+        g.compile()
+        g.forward()
+
+        t2 = torch.from_numpy(np1).permute(2, 0, 1, 3)[:, 1:, ::2]
+        assert np.allclose(arr3.numpy(), t2.reshape(5, 27).numpy())
+        assert np.allclose(arr4.numpy(), (t2.exp() + t2).numpy(), atol=1e-5, rtol=1e-5)
+        assert str(arr2) == str(arr5)
+
+    def test_cpu_binary_broadcast(self):
+        """Test binary operations with row, column and scalar broadcasts on the CPU backend"""
+        print("\nTesting CPU broadcast binary operations:")
+        test_cases = [([5, 37], [37]), ([5, 37], [5, 1]), ([4, 3, 19], [3, 1]), ([64, 33], [1]), ([3, 5, 33], [1, 5, 1])]
+
+        for shape1, shape2 in test_cases:
+            np1 = np.random.randn(*shape1).astype(np.float32)
+            np2 = np.random.rand(*shape2).astype(np.float32) + 0.5
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = Array.from_numpy(np2, device=cpu0)
+            arr3 = (arr1 + arr2) * arr2 - arr1 / arr2
+            arr4 = arr3.sum()
+            g = CPUGraph(arr4, self.ctx)
+            g.compile()
+            g.forward()
+            np3 = (np1 + np2) * np2 - np1 / np2
+            assert np.allclose(arr3.numpy(), np3, atol=1e-3, rtol=1e-4)
+
+    def test_cpu_matmul(self):
+        """Test batched matrix multiplication on the CPU backend"""
+        print("\nTesting CPU matmul:")
+        test_cases = [([2, 3], [3, 4]), ([4, 2, 3], [4, 3, 4]), ([1, 2, 3], [5, 3, 4]), ([2, 5, 1], [2, 1, 3]), ([67, 129], [129, 33]), ([3, 197, 300], [3, 300, 531])]
+
+        for shape1, shape2 in test_cases:
+            np1 = np.random.randn(*shape1).astype(np.float32)
+            np2 = np.random.randn(*shape2).astype(np.float32)
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = Array.from_numpy(np2, device=cpu0)
+            arr3 = arr1 @ arr2
+            arr4 = arr3.sum()
+            g = CPUGraph(arr4, self.ctx)
+            g.compile()
+            g.forward()
+            np3 = np.matmul(np1, np2)
+            assert tuple(arr3.view()) == np3.shape
+            assert np.allclose(arr3.numpy(), np3, atol=1e-3, rtol=0)
+
+    def test_cpu_reduction(self):
+        """Test sum and max reductions on the CPU backend"""
+        print("\nTesting CPU reductions:")
+        shapes = [(2, 3), (19, 29), (297, 101), (256, 1), (1, 997)]
+
+        for shape in shapes:
+            x = torch.randn(*shape, dtype=torch.float32)
+            arr1 = Array.from_numpy(x.numpy(), device=cpu0)
+            arr2 = arr1.sum([1])
+            arr3 = arr1.max([1])
+            arr4 = (arr2 + arr3).sum()
+            g = CPUGraph(arr4, self.ctx)
+            g.compile()
+            g.forward()
+            assert np.allclose(arr2.numpy(), x.sum(dim=1, keepdim=True).numpy(), atol=1e-3, rtol=0)
+            assert np.allclose(arr3.numpy(), x.max(dim=1, keepdim=True)[0].numpy())
+
+    def test_cpu_full_reduction(self):
+        """Test full and per-row reductions on large and transposed inputs on the CPU backend"""
+        print("\nTesting CPU full reductions:")
+        shapes = [(1, 300000), (300000, 3), (257, 1025)]
+
+        for shape in shapes:
+            x = torch.randn(*shape, dtype=torch.float32)
+            arr1 = Array.from_numpy(x.numpy(), device=cpu0)
+            arr2 = arr1.T(0)
+            arr3 = arr1.sum()
+            arr4 = arr2.max()
+            arr5 = arr2.min([1])
+            arr6 = arr3 + arr4 + arr5.sum()
+            g = CPUGraph(arr6, self.ctx)
+            g.compile()
+            g.forward()
+            assert np.allclose(arr3.numpy(), x.sum().numpy(), atol=1e-1, rtol=1e-4)
+            assert np.allclose(arr4.numpy(), x.max().numpy())
+            assert np.allclose(arr5.numpy(), x.T.min(dim=1, keepdim=True)[0].numpy())
+
+    def test_cpu_dims_reduction(self):
+        """Test reductions over several dimensions of strided inputs with and without keepdim on the CPU backend"""
+        print("\nTesting CPU reductions over dimensions:")
+        cases = [((4, 5, 6), [0]), ((4, 5, 6), [1]), ((4, 5, 6), [0, 2]), ((3, 4, 5, 6), [1, -1]), ((2000, 300), [0]), ((7, 1, 9), [1, 2])]
+
+        for shape, dims in cases:
+            for keepdim in [True, False]:
+                x = torch.randn(*shape, dtype=torch.float32)
+                arr1 = Array.from_numpy(x.numpy(), device=cpu0)
+                arr2 = arr1.T(0)
+                arr3 = arr1.sum(dims, keepdim)
+                arr4 = arr2.max(dims, keepdim)
+                arr5 = arr2.min(dims, keepdim)
+                arr6 = (arr3 * arr3).sum() + arr4.sum() + arr5.sum()
+                g = CPUGraph(arr6, self.ctx)
+                g.compile()
+                g.forward()
+                g.backward()
+                xt = x.permute(*reversed(range(x.ndim)))
+                expected = x.sum(dim=dims, keepdim=keepdim)
+                assert np.allclose(arr3.numpy(), expected.numpy(), atol=1e-4)
+                assert np.allclose(arr4.numpy(), xt.amax(dim=dims, keepdim=keepdim).numpy())
+                assert np.allclose(arr5.numpy(), xt.amin(dim=dims, keepdim=keepdim).numpy())
+                assert np.allclose(arr1.grad.numpy(), (2 * x.sum(dim=dims, keepdim=True).expand_as(x)).numpy(), atol=1e-4)
+
+    def test_cpu_initializers(self):
+        """Test full and arange on the CPU backend"""
+        print("\nTesting CPU initializers:")
+        arr1 = Array.arange([3, 4], 2, 3, dtype=i32, device=cpu0)
+        arr2 = Array.full([3, 4], 5, dtype=i32, device=cpu0)
+        arr3 = (arr1 * arr2).sum()
+        g = CPUGraph(arr3, self.ctx)
+        g.compile()
+        g.forward()
+        expected = np.arange(2, 2 + 3 * 12, 3, dtype=np.int32).reshape(3, 4)
+        assert np.array_equal(arr1.numpy(), expected)
+        assert arr3.numpy()[0] == (expected * 5).sum()
+
+    def test_cpu_backprop(self):
+        """Test backward propagation on the CPU backend"""
+        print("\nTesting CPU backprop:")
+        shape = [np.random.randint(1, 20) for _ in range(3)]
+        np1 = np.random.randn(*shape).astype(np.float32)
+        np2 = np.random.randn(*shape).astype(np.float32)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        arr3 = (arr1 * arr2 + arr1).exp()
+        arr4 = (arr3 @ arr2.T(1)).sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile()
+        g.forward()
+        g.backward()
+
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        t3 = (t1 * t2 + t1).exp()
+        t3.retain_grad()
+        t4 = (t3 @ t2.transpose(1, 2)).sum()
+        t4.backward()
+        assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-3)
+        assert np.allclose(arr3.grad.numpy(), t3.grad.numpy(), atol=1e-3, rtol=1e-3)
+        assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-3, rtol=1e-3)
+        assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-3, rtol=1e-3)
+
+    def test_cpu_requires_grad(self):
+        """Test that inputs without requires_grad get no gradient and the others keep theirs"""
+        print("\nTesting CPU requires_grad:")
+        np1 = np.random.rand(17, 29).astype(np.float32) + 0.5
+        np2 = np.random.rand(17, 29).astype(np.float32) + 0.5
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        arr2.set_requires_grad(False)
+        t3 = (t1 * t2).exp().sum() + t2.log().sum()
+        arr3 = (arr1 * arr2).exp().sum() + arr2.log().sum()
+        g = CPUGraph(arr3, self.ctx)
+        g.compile()
+        assert arr1.requires_grad() and arr3.requires_grad()
+        assert not arr2.requires_grad()
+
+        t3.backward()
+        g.forward()
+        g.backward()
+        assert arr2.grad is None
+        assert np.allclose(arr3.numpy(), t3.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+        # A frozen intermediate stops the gradient through it and keeps its flag after compiling
+        t4 = torch.from_numpy(np1).requires_grad_(True)
+        t5 = (t4.detach() * 2).exp().sum() + t4.square().sum()
+        arr4 = Array.from_numpy(np1, device=cpu0)
+        arr5 = arr4 * 2.0
+        arr5.set_requires_grad(False)
+        arr6 = arr5.exp().sum() + arr4.sq().sum()
+        g = CPUGraph(arr6, self.ctx)
+        g.compile()
+        assert not arr5.requires_grad() and arr6.requires_grad()
+        assert arr5.grad is None
+
+        t5.backward()
+        g.forward()
+        g.backward()
+        assert np.allclose(arr6.numpy(), t5.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr4.grad.numpy(), t4.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+        # Max and min have no backward, so inputs reached only through them get no gradient
+        t7 = torch.from_numpy(np2).requires_grad_(True)
+        t8 = t7.exp().sum()
+        arr7 = Array.from_numpy(np1, device=cpu0)
+        arr8 = Array.from_numpy(np2, device=cpu0)
+        arr9 = arr7.max([1]).sum() + arr7.exp().min([0]).sum() + arr8.exp().sum()
+        g = CPUGraph(arr9, self.ctx)
+        g.compile()
+
+        t8.backward()
+        g.forward()
+        g.backward()
+        assert arr7.grad is None
+        assert np.allclose(arr8.grad.numpy(), t7.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_broadcast_grad(self):
+        """Test that gradients of broadcast operands are summed back to their shapes"""
+        print("\nTesting CPU broadcast gradients:")
+        np1 = np.random.rand(33, 70).astype(np.float32) + 0.5
+        np2 = np.random.rand(70).astype(np.float32)
+        np3 = np.random.rand(33, 1).astype(np.float32)
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        t3 = torch.from_numpy(np3).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        arr3 = Array.from_numpy(np3, device=cpu0)
+        t4 = ((t1.square() * 3.0 + t2) * t3).sum()
+        arr4 = ((arr1.sq() * 3.0 + arr2) * arr3).sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile()
+
+        t4.backward()
+        g.forward()
+        g.backward()
+        assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+        assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+        assert np.allclose(arr3.grad.numpy(), t3.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_grad_accumulation(self):
+        """Test gradients of arrays read by many consumers, summed by one kernel instead of into zeros"""
+        print("\nTesting CPU gradient accumulation:")
+        np1 = np.random.rand(19, 31).astype(np.float32) + 0.5
+        nps = [np.random.rand(19, 31).astype(np.float32) for _ in range(10)]
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        t2 = t1.sum() + (-t1).exp().sum() + t1.sqrt().sum()
+        arr2 = arr1.sum() + arr1.neg().exp().sum() + arr1.sqrt().sum()
+        for np3 in nps:
+            arr3 = Array.from_numpy(np3, device=cpu0)
+            arr3.set_requires_grad(False)
+            t2 = t2 + (t1 * torch.from_numpy(np3)).sum()
+            arr2 = arr2 + (arr1 * arr3).sum()
+        g = CPUGraph(arr2, self.ctx)
+        g.compile()
+
+        t2.backward()
+        for _ in range(2):
+            g.forward()
+            g.backward()
+            assert np.allclose(arr2.numpy(), t2.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+        # The summing kernel belongs to the graph, another graph over the gradient still adds in-place
+        g2 = CPUGraph(arr1.grad, self.ctx)
+        g2.compile(inference=True)
+        line = next(line for line in str(g2).splitlines() if line.startswith(str(arr1.grad.id()) + ": "))
+        assert "in-place: 1" in line
+        g2.forward()
+        assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_merge_duplicates(self):
+        """Test that repeated subexpressions are computed once with the same results"""
+        print("\nTesting CPU common subexpression elimination:")
+        np1 = np.random.rand(23, 41).astype(np.float32) + 0.5
+        np2 = np.random.rand(23, 41).astype(np.float32) + 0.5
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t3 = (t1 * t2).exp() + (t1 * t2).log() + t1 / t2
+        t4 = (t3 / t2).sum()
+        arr3 = (arr1 * arr2).exp() + (arr1 * arr2).log() + arr1 / arr2
+        arr4 = (arr3 / arr2).sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile()
+        assert g.num_merged() > 0
+
+        t4.backward()
+        g.forward()
+        g.backward()
+        assert np.allclose(arr3.numpy(), t3.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+        assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_constant_folding(self):
+        """Test that constant scalars are folded into kernels with the same results"""
+        print("\nTesting CPU constant folding:")
+        np1 = np.random.rand(19, 33).astype(np.float32) + 0.5
+        np2 = np.random.rand(19, 33).astype(np.float32)
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t3 = (t1.square() + t1.sqrt()).sum() + (t2 * 3.0).sum()
+        arr3 = (arr1.sq() + arr1.sqrt()).sum() + (arr2 * 3.0).sum()
+        g = CPUGraph(arr3, self.ctx)
+        g.compile()
+        assert g.num_folded() > 0
+
+        t3.backward()
+        for _ in range(2):
+            g.forward()
+            g.backward()
+            assert np.allclose(arr3.numpy(), t3.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_memory_plan(self):
+        """Test that a planned graph computes the same root and input gradients in a smaller arena"""
+        print("\nTesting CPU memory planning:")
+        np1 = np.random.randn(8, 16).astype(np.float32) * 0.3
+        np2 = np.random.randn(16, 16).astype(np.float32) * 0.3
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t3, arr3 = t1, arr1
+        for _ in range(8):
+            t3 = ((t3 @ t2).exp() + t3 * t3).log()
+            arr3 = ((arr3 @ arr2).exp() + arr3 * arr3).log()
+        t4 = t3.sum()
+        arr4 = arr3.sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile(plan_memory=True)
+        assert 0 < g.planned_nbytes() < g.naive_nbytes() / 2
+
+        t4.backward()
+        for _ in range(2):
+            g.forward()
+            g.backward()
+            assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+            assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_inference(self):
+        """Test that an inference graph computes a non-scalar root and has no backward pass"""
+        print("\nTesting CPU inference compilation:")
+        np1 = np.random.randn(16, 64).astype(np.float32) * 0.1
+        np2 = np.random.randn(64, 64).astype(np.float32) * 0.1
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t1 = torch.from_numpy(np1)
+        t2 = torch.from_numpy(np2)
+        arr3, t3 = arr1, t1
+        for _ in range(4):
+            arr3 = (arr3 @ arr2).exp() + arr3
+            t3 = (t3 @ t2).exp() + t3
+        arr4 = arr3.sum([1])
+        g = CPUGraph(arr4, self.ctx)
+        g.compile(inference=True)
+        for _ in range(2):
+            g.forward()
+            assert np.allclose(arr4.numpy(), t3.sum(1).numpy(), rtol=1e-4)
+        assert arr1.grad is None
+        with pytest.raises(RuntimeError):
+            g.backward()
+
+    def test_cpu_placeholder_run(self):
+        """Test that a compiled graph reruns on new batches bound to a placeholder"""
+        print("\nTesting CPU placeholder runs:")
+        np2 = np.random.randn(64, 32).astype(np.float32) * 0.1
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        arr1 = Array.placeholder([16, 64], device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        arr3 = ((arr1 @ arr2).exp() * 2.0).sum()
+        g = CPUGraph(arr3, self.ctx)
+        g.compile(plan_memory=True, fuse=True)
+        for _ in range(3):
+            np1 = np.random.randn(16, 64).astype(np.float32)
+            t1 = torch.from_numpy(np1)
+            t3 = ((t1 @ t2).exp() * 2.0).sum()
+            t3.backward()
+            g.run({arr1: np1})
+            g.backward()
+            assert np.allclose(arr3.numpy(), t3.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+            t2.grad = None
+        assert arr1.grad is None
+        with pytest.raises(ValueError):
+            g.run({arr1: np.zeros((8, 64), dtype=np.float32)})
+
+        # Binding waits for the runs started without waiting, which still read the previous batch
+        np4 = np.random.randn(16, 64).astype(np.float32)
+        np5 = np.random.randn(16, 64).astype(np.float32)
+        t4 = ((torch.from_numpy(np4) @ t2).exp() * 2.0).sum()
+        t5 = ((torch.from_numpy(np5) @ t2).exp() * 2.0).sum()
+        t4.backward()
+        g.run({arr1: np4})
+        for _ in range(4):
+            g.forward_async()
+            g.backward_async()
+        g.run({arr1: np5})
+        assert np.allclose(arr3.numpy(), t5.detach().numpy(), rtol=1e-4)
+        assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_plan_cache(self):
+        """Test that graphs with the same structure reuse one compiled plan"""
+        print("\nTesting CPU plan cache:")
+        clear_plan_cache()
+        graphs = []
+        for i in range(3):
+            np1 = np.random.randn(16, 64).astype(np.float32) * 0.1
+            np2 = np.random.randn(64, 32).astype(np.float32) * 0.1
+            t1 = torch.from_numpy(np1).requires_grad_(True)
+            t2 = torch.from_numpy(np2).requires_grad_(True)
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = Array.from_numpy(np2, device=cpu0)
+            t3 = ((t1 @ t2).exp() * 2.0).sum()
+            arr3 = ((arr1 @ arr2).exp() * 2.0).sum()
+            g = CPUGraph(arr3, self.ctx)
+            g.compile(plan_memory=True, fuse=True, cache=True)
+            assert get_plan_cache_misses() == 1
+            assert get_plan_cache_hits() == i
+            t3.backward()
+            g.forward()
+            g.backward()
+            assert np.allclose(arr3.numpy(), t3.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+            assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+            graphs.append((g, arr1, arr3, t3.detach().numpy(), arr1.grad.numpy().copy()))
+
+        # Graphs taking the same plan keep their own root, gradients and inputs
+        for g, arr1, arr3, np3, np_grad in graphs:
+            g.forward()
+            g.backward()
+        for g, arr1, arr3, np3, np_grad in graphs:
+            assert np.allclose(arr3.numpy(), np3, rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), np_grad, atol=1e-4, rtol=1e-3)
+        assert graphs[0][1].grad.ptr() != graphs[1][1].grad.ptr()
+        arr4 = (Array.from_numpy(np1, device=cpu0) @ Array.from_numpy(np2, device=cpu0)).sum()
+        CPUGraph(arr4, self.ctx).compile(cache=True)
+        assert get_plan_cache_misses() == 2
+
+    def test_cpu_fusion(self):
+        """Test that fused elementwise chains compute the same root and gradients"""
+        print("\nTesting CPU elementwise fusion:")
+        np1 = np.random.randn(37, 129).astype(np.float32) * 0.5
+        np2 = np.random.randn(129, 37).astype(np.float32) * 0.5
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t3 = ((t1 + t2.T) * t1 - t2.T).exp().neg()
+        t4 = (t3 * t1).sum()
+        arr3 = ((arr1 + arr2.T()) * arr1 - arr2.T()).exp().neg()
+        arr4 = (arr3 * arr1).sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile(fuse=True)
+        assert g.num_fused() > 0
+        assert "fused:" in str(g)
+
+        t4.backward()
+        for _ in range(2):
+            g.forward()
+            g.backward()
+            assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+            assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+
+    def test_cpu_simplify(self):
+        """Test that algebraic rewrites remove kernels and keep the root and gradients"""
+        print("\nTesting CPU algebraic simplification:")
+        np1 = np.random.rand(23, 37).astype(np.float32) + 0.5
+        np2 = np.random.rand(23, 37).astype(np.float32) + 0.5
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        t2 = torch.from_numpy(np2).requires_grad_(True)
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = Array.from_numpy(np2, device=cpu0)
+        t3 = (-(-(t1 / t2)) + (-t2)) * t2.exp()
+        t4 = (t3 @ t1.T).sum()
+        arr3 = (arr1.permute([1, 0]).permute([1, 0]) * arr2.recip()).neg().neg() + arr2.neg()
+        arr3 = arr3 * arr2.exp()
+        arr4 = (arr3.identity() @ arr1.T()).sum()
+        g = CPUGraph(arr4, self.ctx)
+        g.compile(simplify=True)
+        assert g.num_simplified() > 0
+        assert g.simplified_nbytes() > 0
+
+        t4.backward()
+        for _ in range(2):
+            g.forward()
+            g.backward()
+            assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-3, rtol=1e-3)
+            assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-3, rtol=1e-3)
+
+        # The rewrites belong to the graph, another graph over the same arrays still computes their own ops
+        g2 = CPUGraph(arr4, self.ctx)
+        g2.compile(inference=True)
+        g2.forward()
+        assert g2.num_simplified() == 0
+        assert "recip" in str(g2)
+        assert np.allclose(arr4.numpy(), t4.detach().numpy(), rtol=1e-4)
+
+        # Views of views that earlier rewrites already replaced or removed
+        t5 = t1.detach().requires_grad_(True)
+        t6 = t5.T.T.T.exp().sum()
+        t6.backward()
+        for options in [{}, {"plan_memory": True}, {"fuse": True}, {"plan_memory": True, "fuse": True}]:
+            arr5 = Array.from_numpy(np1, device=cpu0)
+            arr6 = arr5.permute([1, 0]).permute([1, 0]).permute([1, 0]).exp().sum()
+            g3 = CPUGraph(arr6, self.ctx)
+            g3.compile(simplify=True, **options)
+            g3.forward()
+            g3.backward()
+            assert np.allclose(arr6.numpy(), t6.detach().numpy(), rtol=1e-4)
+            assert np.allclose(arr5.grad.numpy(), t5.grad.numpy(), rtol=1e-4)
+
+    def test_cpu_caching_allocator(self):
+        """Test the allocator counters and that empty_cache only releases cached blocks"""
+        print("\nTesting CPU caching allocator:")
+        np1 = np.random.randn(64, 33).astype(np.float32)
+        for _ in range(2):
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = (arr1.exp() * arr1).sum()
+            g = CPUGraph(arr2, self.ctx)
+            g.compile()
+            g.forward()
+            assert np.allclose(arr2.numpy(), (np.exp(np1) * np1).sum(), rtol=1e-4)
+            assert cpu0.memory_reserved() >= cpu0.memory_allocated() > 0
+        cpu0.empty_cache()
+        assert cpu0.memory_reserved() == cpu0.memory_allocated()
+
+    def test_cpu_num_workers(self):
+        """Test that results do not depend on the number of CPU workers"""
+        print("\nTesting CPU worker count:")
+        np1 = np.random.randn(300, 500).astype(np.float32)
+        np2 = np.random.randn(500, 400).astype(np.float32)
+        workers = get_num_workers()
+        results = []
+        for num_workers in [1, 4]:
+            set_num_workers(num_workers)
+            assert get_num_workers() == num_workers
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = Array.from_numpy(np2, device=cpu0)
+            arr3 = (arr1.exp() * arr1 + arr1) @ arr2
+            arr4 = arr3.sum()
+            g = CPUGraph(arr4, self.ctx)
+            g.compile()
+            g.forward()
+            results.append(arr3.numpy().copy())
+
+        # Changing the number of workers with runs still queued lets them finish on the old workers
+        np3 = np.random.randn(256, 256).astype(np.float32) * 0.05
+        arr5 = Array.from_numpy(np3, device=cpu0)
+        arr6 = (arr5 @ arr5).exp().sum()
+        g = CPUGraph(arr6, self.ctx)
+        g.compile(inference=True)
+        futures = [g.forward_async() for _ in range(8)]
+        set_num_workers(2)
+        for future in futures:
+            future.wait()
+        assert get_num_workers() == 2
+        assert np.allclose(arr6.numpy(), np.exp(np3 @ np3).sum(), rtol=1e-3)
+        set_num_workers(workers)
+        expected = (np.exp(np1) * np1 + np1) @ np2
+        assert np.allclose(results[0], expected, atol=1e-2, rtol=1e-3)
+        assert np.allclose(results[1], results[0], atol=1e-3, rtol=1e-4)
+
+    def test_cpu_concurrent_branches(self):
+        """Test that independent branches run concurrently compute the same root and gradients"""
+        print("\nTesting CPU concurrent branches:")
+        np1 = np.random.randn(32, 48).astype(np.float32) * 0.2
+        nps = [np.random.randn(48, 40).astype(np.float32) * 0.2 for _ in range(6)]
+        t1 = torch.from_numpy(np1).requires_grad_(True)
+        ts = [torch.from_numpy(np2).requires_grad_(True) for np2 in nps]
+        t3 = sum(((t1 @ t2).exp() * float(i + 1)) for i, t2 in enumerate(ts)).sqrt().sum()
+        t3.backward()
+        workers = get_num_workers()
+        set_num_workers(4)
+        for plan_memory in [False, True]:
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arrs = [Array.from_numpy(np2, device=cpu0) for np2 in nps]
+            arr3 = (arr1 @ arrs[0]).exp() * 1.0
+            for i, arr2 in enumerate(arrs[1:]):
+                arr3 = arr3 + (arr1 @ arr2).exp() * float(i + 2)
+            arr4 = arr3.sqrt().sum()
+            g = CPUGraph(arr4, self.ctx)
+            g.compile(plan_memory=plan_memory, fuse=True)
+            for _ in range(3):
+                g.forward()
+                g.backward()
+                assert np.allclose(arr4.numpy(), t3.detach().numpy(), rtol=1e-4)
+                assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+                for arr2, t2 in zip(arrs, ts):
+                    assert np.allclose(arr2.grad.numpy(), t2.grad.numpy(), atol=1e-4, rtol=1e-3)
+        set_num_workers(workers)
+
+    def test_cpu_async(self):
+        """Test that runs started without waiting follow the order of graphs sharing arrays"""
+        print("\nTesting CPU asynchronous runs:")
+        np1 = np.random.randn(64, 32).astype(np.float32)
+        expected = np1.copy()
+        arr1 = Array.from_numpy(np1, device=cpu0)
+        arr2 = self_add(arr1, 1.0).sum()
+        g1 = CPUGraph(arr2, self.ctx)
+        g1.compile(inference=True)
+        arr3 = (arr1 * arr1).sum()
+        g2 = CPUGraph(arr3, self.ctx)
+        g2.compile(plan_memory=True)
+        g1.forward_async()
+        g2.forward_async()
+        future = g2.backward_async()
+        g1.forward_async()
+        future.wait()
+        assert future.done()
+        g1.wait()
+        assert np.allclose(arr1.grad.numpy(), 2 * (expected + 1), rtol=1e-5)
+        g2.forward_async().wait()
+        assert np.allclose(arr3.numpy(), ((expected + 2) ** 2).sum(), rtol=1e-4)
+        g3 = CPUGraph(arr1.exp().sum(), self.ctx)
+        with pytest.raises(RuntimeError):
+            g3.forward_async().wait()
+
+        # A graph freed with runs still queued waits for them first
+        arr4 = (arr1.exp() * 2.0).sum()
+        g4 = CPUGraph(arr4, self.ctx)
+        g4.compile(plan_memory=True, fuse=True)
+        for _ in range(4):
+            g4.forward_async()
+            g4.backward_async()
+        del g4
+        assert np.allclose(arr4.numpy(), (np.exp(expected + 2) * 2).sum(), rtol=1e-4)
+
+    def test_cpu_threads(self):
+        """Test that graphs sharing an input run correctly from several Python threads"""
+        print("\nTesting CPU graphs on several threads:")
+        np_w = np.random.randn(32, 16).astype(np.float32) * 0.5
+        arr_w = Array.from_numpy(np_w, device=cpu0)
+        arr_w.set_requires_grad(False)
+        nps = [np.random.randn(8, 32).astype(np.float32) * 0.5 for _ in range(4)]
+        errors = []
+
+        def train(np1):
+            try:
+                arr1 = Array.from_numpy(np1, device=cpu0)
+                arr2 = (arr1 @ arr_w).exp().sum()
+                g = CPUGraph(arr2, self.ctx)
+                g.compile(fuse=True)
+                t1 = torch.from_numpy(np1).requires_grad_(True)
+                t2 = (t1 @ torch.from_numpy(np_w)).exp().sum()
+                t2.backward()
+                for _ in range(5):
+                    g.forward()
+                    g.backward()
+                    assert np.allclose(arr2.numpy(), t2.detach().numpy(), rtol=1e-4)
+                    assert np.allclose(arr1.grad.numpy(), t1.grad.numpy(), atol=1e-4, rtol=1e-3)
+            except Exception as e:
+                errors.append(e)
+
+        threads = [threading.Thread(target=train, args=(np1,)) for np1 in nps]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        assert not errors, errors
+
+    def test_cpu_thread_ids(self):
+        """Test that arrays built on several threads get distinct ids"""
+        print("\nTesting CPU array ids on several threads:")
+        ids = [[] for _ in range(4)]
+
+        def build(idx):
+            arr = Array.from_numpy(np.ones(4, dtype=np.float32), device=cpu0)
+            for _ in range(3000):
+                arr = arr + 1.0
+                ids[idx].append(arr.id().data())
+
+        threads = [threading.Thread(target=build, args=(idx,)) for idx in range(4)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        all_ids = [id for thread_ids in ids for id in thread_ids]
+        assert len(set(all_ids)) == len(all_ids)
+        assert all(thread_ids == sorted(thread_ids) for thread_ids in ids)
+
+    def test_cpu_deep_chain(self):
+        """Test that a chain deeper than the native stack compiles, runs and frees"""
+        print("\nTesting CPU deep chain:")
+        np1 = np.random.rand(8).astype(np.float32)
+        for options in [{}, {"plan_memory": True}, {"fuse": True}]:
+            arr1 = Array.from_numpy(np1, device=cpu0)
+            arr2 = arr1
+            for i in range(100000):
+                arr2 = arr2 + arr1 if i % 2 == 0 else arr2 - arr1 * 0.5
+            arr3 = arr2.sum()
+            g = CPUGraph(arr3, self.ctx)
+            g.compile(**options)
+            g.forward()
+            g.backward()
+            grad = 1 + 50000 * 0.5
+            assert np.allclose(arr3.numpy(), (np1 * grad).sum(), rtol=1e-3)
+            assert np.allclose(arr1.grad.numpy(), np.full(8, grad), rtol=1e-3)
+            del g, arr1, arr2, arr3
@@ -0,0 +1,222 @@
+#pragma once
+
+#include "simd.h"
+#include "parallel.h"
+#include "utils.h"
+
+namespace xv::backend::cpu
+{
+    // Arithmetic functors have a SIMD overload, comparisons produce bytes and stay scalar
+    struct Add
+    {
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs + rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return lhs + rhs; }
+    };
+
+    struct Sub
+    {
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs - rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return lhs - rhs; }
+    };
+
+    struct Mul
+    {
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs * rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return lhs * rhs; }
+    };
+
+    struct Div
+    {
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs / rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return lhs / rhs; }
+    };
+
+    struct Eq
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs == rhs; }
+    };
+
+    struct Neq
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs != rhs; }
+    };
+
+    struct Lt
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs < rhs; }
+    };
+
+    struct Gt
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs > rhs; }
+    };
+
+    struct Leq
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs <= rhs; }
+    };
+
+    struct Geq
+    {
+        template <class T>
+        bool operator()(T lhs, T rhs) const { return lhs >= rhs; }
+    };
+
+    // Applies the op to n elements, an operand with stride 0 is broadcast
+    template <class Op, class T, class R>
+    inline void binary_row(const T *lhs, isize lhs_stride, const T *rhs, isize rhs_stride, R *output, isize output_stride, usize n)
+    {
+        usize i = 0;
+        if constexpr (std::is_same_v<T, R> && !std::is_same_v<R, bool>)
+        {
+            using Vec = simd::Vec<T>;
+            constexpr usize width = Vec::width;
+            if (output_stride == 1 && (lhs_stride == 0 || lhs_stride == 1) && (rhs_stride == 0 || rhs_stride == 1))
+            {
+                if (lhs_stride == 1 && rhs_stride == 1)
+                {
+                    for (; i + width <= n; i += width)
+                    {
+                        Op()(Vec::load(lhs + i), Vec::load(rhs + i)).store(output + i);
+                    }
+                }
+                else if (lhs_stride == 1)
+                {
+                    // Scalar or column broadcast on the right, splat once
+                    Vec r(*rhs);
+                    for (; i + width <= n; i += width)
+                    {
+                        Op()(Vec::load(lhs + i), r).store(output + i);
+                    }
+                }
+                else if (rhs_stride == 1)
+                {
+                    Vec l(*lhs);
+                    for (; i + width <= n; i += width)
+                    {
+                        Op()(l, Vec::load(rhs + i)).store(output + i);
+                    }
+                }
+                else
+                {
+                    auto v = Op()(Vec(*lhs), Vec(*rhs));
+                    for (; i + width <= n; i += width)
+                    {
+                        v.store(output + i);
+                    }
+                }
+            }
+        }
+        // Scalar tail and generic strided loop
+        for (; i < n; i++)
+        {
+            output[i * output_stride] = Op()(lhs[i * lhs_stride], rhs[i * rhs_stride]);
+        }
+    }
+
+    // Walks the operands row by row through a shared indexer ordered by the output strides, where a row broadcast (bias)
+    // operand has an outer stride of 0 and a column broadcast one an inner stride of 0. Operands that merge into a single
+    // dimension (contiguous or a single broadcast value) form one row that is split across threads.
+    template <class Op, class T, class R>
+    void binary_rows(const T *lhs, const ShapeStride &lhs_stride, const T *rhs, const ShapeStride &rhs_stride,
+                     R *output, const ShapeStride &output_stride, const ShapeView &view)
+    {
+        StridedIndexer<3> indexer(view, {output_stride, lhs_stride, rhs_stride}, true);
+        const usize n = indexer.get_inner_size();
+        const isize os = indexer.get_inner_stride(0);
+        const isize ls = indexer.get_inner_stride(1);
+        const isize rs = indexer.get_inner_stride(2);
+        if (indexer.get_num_rows() == 1)
+        {
+            parallel_for(0, n, elementwise_grain, [&](usize begin, usize end)
+                         { binary_row<Op>(lhs + begin * ls, ls, rhs + begin * rs, rs, output + begin * os, os, end - begin); });
+            return;
+        }
+        parallel_for(0, indexer.get_num_rows(), row_grain(n), [&](usize begin, usize end)
+                     { indexer.for_each_row(begin, end, [&](const std::array<isize, 3> &offsets)
+                                            { binary_row<Op>(lhs + offsets[1], ls, rhs + offsets[2], rs, output + offsets[0], os, n); }); });
+    }
+
+    // Binary operations for scalar-scalar
+    template <class Op, class T, class R>
+    void binary_ss_vv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto lhs = typed_ptr<T>(arrs[0]);
+        auto rhs = typed_ptr<T>(arrs[1]);
+        auto output = typed_ptr<R>(arrs[2]);
+        parallel_for(0, arrs[0]->get_numel(), elementwise_grain, [&](usize begin, usize end)
+                     { binary_row<Op>(lhs + begin, 1, rhs + begin, 1, output + begin, 1, end - begin); });
+    }
+
+    template <class Op, class T, class R>
+    void binary_ss_sv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto lhs = typed_ptr<T>(arrs[0]);
+        auto rhs = typed_ptr<T>(arrs[1]);
+        auto output = typed_ptr<R>(arrs[2]);
+        auto &view = arrs[0]->get_view();
+        auto contiguous_stride = arrs[0]->get_shape().get_contiguous_stride();
+        auto output_stride = arrs[2]->get_stride();
+        binary_rows<Op>(lhs, contiguous_stride, rhs, contiguous_stride, output, output_stride, view);
+    }
+
+    // Pointer and strides of operand i, an immediate given by params as (i, bits) is read from value with zero strides
+    template <class T>
+    inline const T *binary_operand(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params, usize i, T &value, ShapeStride &stride)
+    {
+        if (params.empty() || params[0] != static_cast<isize>(i))
+        {
+            stride = arrs[i]->get_stride();
+            return typed_ptr<T>(arrs[i]);
+        }
+        if constexpr (sizeof(T) == sizeof(int32_t))
+        {
+            value = std::bit_cast<T>(static_cast<int32_t>(params[1]));
+        }
+        stride.assign(arrs[2]->get_ndim(), 0);
+        return &value;
+    }
+
+    template <class Op, class T, class R>
+    void binary_ss_vs(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        T lhs_value, rhs_value;
+        ShapeStride lhs_stride, rhs_stride;
+        auto lhs = binary_operand<T>(arrs, params, 0, lhs_value, lhs_stride);
+        auto rhs = binary_operand<T>(arrs, params, 1, rhs_value, rhs_stride);
+        auto output = typed_ptr<R>(arrs[2]);
+        auto &view = arrs[2]->get_view();
+        auto output_stride = arrs[2]->get_shape().get_contiguous_stride();
+        binary_rows<Op>(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, view);
+    }
+
+    template <class Op, class T, class R>
+    void binary_ss_ss(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        T lhs_value, rhs_value;
+        ShapeStride lhs_stride, rhs_stride;
+        auto lhs = binary_operand<T>(arrs, params, 0, lhs_value, lhs_stride);
+        auto rhs = binary_operand<T>(arrs, params, 1, rhs_value, rhs_stride);
+        auto output = typed_ptr<R>(arrs[2]);
+        auto &view = arrs[2]->get_view();
+        auto output_stride = arrs[2]->get_stride();
+        binary_rows<Op>(lhs, lhs_stride, rhs, rhs_stride, output, output_stride, view);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#include "cpu_binary.h"
+
+namespace xv::backend::cpu
+{
+    void binary_ss(const std::string &name, ArrayPtr lhs, ArrayPtr rhs, ArrayPtr output, std::shared_ptr<CPUContext> ctx, const std::vector<isize> &params)
+    {
+        // An immediate is read with zero strides, which only the strided-input kernels handle
+        bool strided_input = !params.empty() || !lhs->is_contiguous() || !rhs->is_contiguous();
+        bool strided_output = !output->is_contiguous();
+        const std::string mode = std::string(strided_output ? "s" : "v") + std::string(strided_input ? "s" : "v");
+        const std::string kernel_name = name + "_" + mode + "_" + lhs->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({lhs, rhs, output}, params);
+    }
+}
\ No newline at end of file
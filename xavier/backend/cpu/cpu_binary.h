@@ -0,0 +1,9 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    // With params, the operand at params[0] has no buffer and holds the single value whose bits are params[1]
+    void binary_ss(const std::string &name, ArrayPtr lhs, ArrayPtr rhs, ArrayPtr output, std::shared_ptr<CPUContext> ctx, const std::vector<isize> &params = {});
+}
\ No newline at end of file
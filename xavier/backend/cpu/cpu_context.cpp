@@ -0,0 +1,133 @@
+#include "cpu_context.h"
+#include "initializers.h"
+#include "unary.h"
+#include "binary.h"
+#include "matmul.h"
+#include "reduction.h"
+#include "fused.h"
+
+namespace xv::backend::cpu
+{
+    void CPUContext::init_kernel(const std::string &name, const Dtype &dtype, CPUKernelFn fn)
+    {
+        kernels[name] = std::make_shared<CPUKernel>(name, dtype, fn);
+    }
+
+    template <class Op, class T, class R>
+    void CPUContext::init_unary_kernels(const std::string &op, const Dtype &dtype)
+    {
+        init_kernel(op + "_vv_" + dtype.get_name(), dtype, unary_ss_vv<Op, T, R>);
+        init_kernel(op + "_sv_" + dtype.get_name(), dtype, unary_ss_sv<Op, T, R>);
+        init_kernel(op + "_vs_" + dtype.get_name(), dtype, unary_ss_vs<Op, T, R>);
+        init_kernel(op + "_ss_" + dtype.get_name(), dtype, unary_ss_ss<Op, T, R>);
+    }
+
+    template <class Op, class T, class R>
+    void CPUContext::init_binary_kernels(const std::string &op, const Dtype &dtype)
+    {
+        init_kernel(op + "_vv_" + dtype.get_name(), dtype, binary_ss_vv<Op, T, R>);
+        init_kernel(op + "_sv_" + dtype.get_name(), dtype, binary_ss_sv<Op, T, R>);
+        init_kernel(op + "_vs_" + dtype.get_name(), dtype, binary_ss_vs<Op, T, R>);
+        init_kernel(op + "_ss_" + dtype.get_name(), dtype, binary_ss_ss<Op, T, R>);
+    }
+
+    template <class Op, class T, class R>
+    void CPUContext::init_reduction_kernels(const std::string &op, const Dtype &dtype)
+    {
+        init_kernel(op + "_all_vv_" + dtype.get_name(), dtype, reduce_all_vv<Op, T, R>);
+        init_kernel(op + "_all_vs_" + dtype.get_name(), dtype, reduce_all_vs<Op, T, R>);
+        init_kernel(op + "_dims_vv_" + dtype.get_name(), dtype, reduce_dims_vv<Op, T, R>);
+        init_kernel(op + "_dims_vs_" + dtype.get_name(), dtype, reduce_dims_vs<Op, T, R>);
+    }
+
+    void CPUContext::init_initializer_kernels()
+    {
+        init_kernel("full_f32", f32, full<float>);
+        init_kernel("full_i32", i32, full<int32_t>);
+        init_kernel("full_b8", b8, full<bool>);
+        init_kernel("arange_f32", f32, arange<float>);
+        init_kernel("arange_i32", i32, arange<int32_t>);
+    }
+
+    void CPUContext::init_unary_kernels()
+    {
+        init_unary_kernels<Identity, float, float>("identity", f32);
+        init_unary_kernels<Identity, int32_t, int32_t>("identity", i32);
+        init_unary_kernels<Exp, float, float>("exp", f32);
+        init_unary_kernels<Exp, int32_t, int32_t>("exp", i32);
+        init_unary_kernels<Log, float, float>("log", f32);
+        init_unary_kernels<Log, int32_t, float>("log", i32);
+        init_unary_kernels<Neg, float, float>("neg", f32);
+        init_unary_kernels<Neg, int32_t, int32_t>("neg", i32);
+        init_unary_kernels<Recip, float, float>("recip", f32);
+        init_unary_kernels<Recip, int32_t, float>("recip", i32);
+        init_unary_kernels<Sq, float, float>("sq", f32);
+        init_unary_kernels<Sq, int32_t, int32_t>("sq", i32);
+        init_unary_kernels<Sqrt, float, float>("sqrt", f32);
+        init_unary_kernels<Sqrt, int32_t, float>("sqrt", i32);
+    }
+
+    void CPUContext::init_binary_kernels()
+    {
+        init_binary_kernels<Add, float, float>("add", f32);
+        init_binary_kernels<Add, int32_t, int32_t>("add", i32);
+        init_binary_kernels<Sub, float, float>("sub", f32);
+        init_binary_kernels<Sub, int32_t, int32_t>("sub", i32);
+        init_binary_kernels<Mul, float, float>("mul", f32);
+        init_binary_kernels<Mul, int32_t, int32_t>("mul", i32);
+        init_binary_kernels<Div, float, float>("div", f32);
+        init_binary_kernels<Div, int32_t, int32_t>("div", i32);
+        init_binary_kernels<Eq, float, bool>("eq", f32);
+        init_binary_kernels<Eq, int32_t, bool>("eq", i32);
+        init_binary_kernels<Eq, bool, bool>("eq", b8);
+        init_binary_kernels<Neq, float, bool>("neq", f32);
+        init_binary_kernels<Neq, int32_t, bool>("neq", i32);
+        init_binary_kernels<Neq, bool, bool>("neq", b8);
+        init_binary_kernels<Lt, float, bool>("lt", f32);
+        init_binary_kernels<Lt, int32_t, bool>("lt", i32);
+        init_binary_kernels<Gt, float, bool>("gt", f32);
+        init_binary_kernels<Gt, int32_t, bool>("gt", i32);
+        init_binary_kernels<Leq, float, bool>("leq", f32);
+        init_binary_kernels<Leq, int32_t, bool>("leq", i32);
+        init_binary_kernels<Geq, float, bool>("geq", f32);
+        init_binary_kernels<Geq, int32_t, bool>("geq", i32);
+        init_kernel("matmul_vv_f32", f32, matmul_vv<float, float>);
+        init_kernel("matmul_vv_i32", i32, matmul_vv<int32_t, int32_t>);
+        init_kernel("matmul_vs_f32", f32, matmul_vs<float, float>);
+        init_kernel("matmul_vs_i32", i32, matmul_vs<int32_t, int32_t>);
+    }
+
+    void CPUContext::init_reduction_kernels()
+    {
+        init_reduction_kernels<Sum, float, float>("sum", f32);
+        init_reduction_kernels<Sum, int32_t, int32_t>("sum", i32);
+        init_reduction_kernels<Max, float, float>("max", f32);
+        init_reduction_kernels<Max, int32_t, int32_t>("max", i32);
+        init_reduction_kernels<Min, float, float>("min", f32);
+        init_reduction_kernels<Min, int32_t, int32_t>("min", i32);
+    }
+
+    void CPUContext::init_fused_kernels()
+    {
+        init_kernel("fused_ss_f32", f32, fused_ss<float>);
+    }
+
+    CPUContext::CPUContext()
+    {
+        // Initializes kernels here
+        init_initializer_kernels();
+        init_unary_kernels();
+        init_binary_kernels();
+        init_reduction_kernels();
+        init_fused_kernels();
+    }
+
+    void CPUContext::register_kernel(const std::string &name, std::shared_ptr<CPUKernel> kernel)
+    {
+        if (kernels.contains(name))
+        {
+            throw std::invalid_argument("Cannot register existing kernel " + name + ".");
+        }
+        kernels.insert(std::make_pair(name, kernel));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "cpu_kernel.h"
+
+namespace xv::backend::cpu
+{
+    class CPUContext : public std::enable_shared_from_this<CPUContext>
+    {
+    private:
+        std::unordered_map<std::string, std::shared_ptr<CPUKernel>> kernels;
+
+        void init_kernel(const std::string &name, const Dtype &dtype, CPUKernelFn fn);
+
+        template <class Op, class T, class R>
+        void init_unary_kernels(const std::string &op, const Dtype &dtype);
+
+        template <class Op, class T, class R>
+        void init_binary_kernels(const std::string &op, const Dtype &dtype);
+
+        template <class Op, class T, class R>
+        void init_reduction_kernels(const std::string &op, const Dtype &dtype);
+
+        void init_initializer_kernels();
+        void init_unary_kernels();
+        void init_binary_kernels();
+        void init_reduction_kernels();
+        void init_fused_kernels();
+
+    public:
+        CPUContext();
+
+        void register_kernel(const std::string &name, std::shared_ptr<CPUKernel> kernel);
+
+        std::shared_ptr<CPUKernel> get_kernel(const std::string &name)
+        {
+            auto kernel = kernels.find(name);
+            if (kernel == kernels.end())
+            {
+                throw std::invalid_argument("Kernel " + name + " is not supported on the CPU.");
+            }
+            return kernel->second;
+        }
+    };
+}
\ No newline at end of file
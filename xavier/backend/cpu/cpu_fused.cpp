@@ -0,0 +1,13 @@
+#include "cpu_fused.h"
+
+namespace xv::backend::cpu
+{
+    void fused(const std::vector<ArrayPtr> &inputs, ArrayPtr output, const std::vector<isize> &code, std::shared_ptr<CPUContext> ctx)
+    {
+        // One kernel walks every layout, the program itself is passed as parameters
+        const std::string kernel_name = "fused_ss_" + output->get_dtype().str();
+        std::vector<ArrayPtr> arrs = inputs;
+        arrs.push_back(output);
+        ctx->get_kernel(kernel_name)->run(arrs, code);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    // Inputs a fused kernel reads at most, which bounds the indexer it walks them with
+    inline constexpr usize max_fused_inputs = 8;
+
+    void fused(const std::vector<ArrayPtr> &inputs, ArrayPtr output, const std::vector<isize> &code, std::shared_ptr<CPUContext> ctx);
+}
\ No newline at end of file
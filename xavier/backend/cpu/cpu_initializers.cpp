@@ -0,0 +1,16 @@
+#include "cpu_initializers.h"
+
+namespace xv::backend::cpu
+{
+    void full(ArrayPtr arr, int c, usize, std::shared_ptr<CPUContext> ctx)
+    {
+        const std::string kernel_name = "full_" + arr->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({arr}, {c});
+    }
+
+    void arange(ArrayPtr arr, int start, int step, std::shared_ptr<CPUContext> ctx)
+    {
+        const std::string kernel_name = "arange_" + arr->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({arr}, {start, step});
+    }
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    void full(ArrayPtr arr, int c, usize size, std::shared_ptr<CPUContext> ctx);
+    void arange(ArrayPtr arr, int start, int step, std::shared_ptr<CPUContext> ctx);
+}
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../../core/array.h"
+#include "../../core/dtype.h"
+
+namespace xv::backend::cpu
+{
+    using namespace xv::core;
+
+    // Arrays are passed as inputs followed by the output, scalars such as constants are passed as parameters
+    using CPUKernelFn = void (*)(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params);
+
+    struct CPUKernel : public std::enable_shared_from_this<CPUKernel>
+    {
+    private:
+        std::string name;
+        CPUKernelFn fn;
+        Dtype dtype;
+
+    public:
+        CPUKernel(const std::string &name, Dtype dtype, CPUKernelFn fn) : name(name), fn(fn), dtype(dtype) {}
+
+        const std::string &get_name() { return name; }
+
+        Dtype get_dtype() { return dtype; }
+
+        void run(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params = {}) { fn(arrs, params); }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#include "cpu_matmul.h"
+
+namespace xv::backend::cpu
+{
+    void matmul(ArrayPtr lhs, ArrayPtr rhs, ArrayPtr output, std::shared_ptr<CPUContext> ctx)
+    {
+        bool strided_input = !lhs->is_contiguous() || !rhs->is_contiguous();
+        const std::string mode = "v" + std::string(strided_input ? "s" : "v");
+        const std::string kernel_name = "matmul_" + mode + "_" + lhs->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({lhs, rhs, output});
+    }
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    void matmul(ArrayPtr lhs, ArrayPtr rhs, ArrayPtr output, std::shared_ptr<CPUContext> ctx);
+}
\ No newline at end of file
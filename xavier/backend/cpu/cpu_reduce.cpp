@@ -0,0 +1,20 @@
+#include "cpu_reduce.h"
+
+namespace xv::backend::cpu
+{
+    void reduce_all(const std::string &name, ArrayPtr input, ArrayPtr output, std::shared_ptr<CPUContext> ctx)
+    {
+        bool strided_input = !input->is_contiguous();
+        const std::string mode = "v" + std::string(strided_input ? "s" : "v");
+        const std::string kernel_name = name + "_all_" + mode + "_" + input->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({input, output});
+    }
+
+    void reduce_dims(const std::string &name, ArrayPtr input, ArrayPtr output, const std::vector<usize> &dims, std::shared_ptr<CPUContext> ctx)
+    {
+        bool strided_input = !input->is_contiguous();
+        const std::string mode = "v" + std::string(strided_input ? "s" : "v");
+        const std::string kernel_name = name + "_dims_" + mode + "_" + input->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({input, output}, std::vector<isize>(dims.begin(), dims.end()));
+    }
+}
\ No newline at end of file
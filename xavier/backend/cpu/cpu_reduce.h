@@ -0,0 +1,9 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    void reduce_all(const std::string &name, ArrayPtr input, ArrayPtr output, std::shared_ptr<CPUContext> ctx);
+    void reduce_dims(const std::string &name, ArrayPtr input, ArrayPtr output, const std::vector<usize> &dims, std::shared_ptr<CPUContext> ctx);
+}
\ No newline at end of file
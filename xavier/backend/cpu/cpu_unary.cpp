@@ -0,0 +1,13 @@
+#include "cpu_unary.h"
+
+namespace xv::backend::cpu
+{
+    void unary_ss(const std::string &name, ArrayPtr input, ArrayPtr output, std::shared_ptr<CPUContext> ctx)
+    {
+        bool strided_input = !input->is_contiguous();
+        bool strided_output = !output->is_contiguous();
+        const std::string mode = std::string(strided_output ? "s" : "v") + std::string(strided_input ? "s" : "v");
+        const std::string kernel_name = name + "_" + mode + "_" + input->get_dtype().str();
+        ctx->get_kernel(kernel_name)->run({input, output});
+    }
+}
\ No newline at end of file
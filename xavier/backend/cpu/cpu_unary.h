@@ -0,0 +1,8 @@
+#pragma once
+
+#include "cpu_context.h"
+
+namespace xv::backend::cpu
+{
+    void unary_ss(const std::string &name, ArrayPtr input, ArrayPtr output, std::shared_ptr<CPUContext> ctx);
+}
\ No newline at end of file
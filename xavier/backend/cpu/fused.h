@@ -0,0 +1,184 @@
+#pragma once
+
+#include "unary.h"
+#include "binary.h"
+#include "cpu_fused.h"
+
+namespace xv::backend::cpu
+{
+    // Elements evaluated by each step of a fused program, small enough for every register to stay in L1
+    inline constexpr usize fused_block = 256;
+
+    struct FusedInstr
+    {
+        OpName name;
+        usize lhs;
+        usize rhs;
+    };
+
+    template <class Op, class T>
+    inline void fused_unary(const T *input, T *output, usize n)
+    {
+        unary_row<Op>(input, 1, output, 1, n);
+    }
+
+    template <class Op, class T>
+    inline void fused_binary(const T *lhs, const T *rhs, T *output, usize n)
+    {
+        binary_row<Op>(lhs, 1, rhs, 1, output, 1, n);
+    }
+
+    template <class T>
+    void fused_instr(const FusedInstr &instr, const T *lhs, const T *rhs, T *output, usize n)
+    {
+        switch (instr.name)
+        {
+        case OpName::ADD:
+            return fused_binary<Add>(lhs, rhs, output, n);
+        case OpName::SUB:
+            return fused_binary<Sub>(lhs, rhs, output, n);
+        case OpName::MUL:
+            return fused_binary<Mul>(lhs, rhs, output, n);
+        case OpName::DIV:
+            return fused_binary<Div>(lhs, rhs, output, n);
+        case OpName::SQ:
+            return fused_unary<Sq>(lhs, output, n);
+        case OpName::SQRT:
+            return fused_unary<Sqrt>(lhs, output, n);
+        case OpName::NEG:
+            return fused_unary<Neg>(lhs, output, n);
+        case OpName::IDENTITY:
+            return fused_unary<Identity>(lhs, output, n);
+        case OpName::EXP:
+            return fused_unary<Exp>(lhs, output, n);
+        case OpName::LOG:
+            return fused_unary<Log>(lhs, output, n);
+        case OpName::RECIP:
+            return fused_unary<Recip>(lhs, output, n);
+        default:
+            throw std::invalid_argument("Operation " + opnames.at(instr.name) + " cannot be fused.");
+        }
+    }
+
+    // Evaluates the program over n elements of a row in blocks. Unit-stride inputs are read in place and the others are
+    // gathered once per block, the last instruction writes to the output directly when it is unit-stride.
+    template <class T>
+    void fused_row(const std::vector<FusedInstr> &code, const std::vector<const T *> &inputs, const isize *input_strides,
+                   T *output, isize output_stride, usize n, T *scratch)
+    {
+        const usize num_inputs = inputs.size();
+        std::array<const T *, max_fused_inputs> srcs;
+        for (usize begin = 0; begin < n; begin += fused_block)
+        {
+            const usize m = std::min(fused_block, n - begin);
+            for (usize i = 0; i < num_inputs; i++)
+            {
+                const T *input = inputs[i] + static_cast<isize>(begin) * input_strides[i];
+                if (input_strides[i] == 1)
+                {
+                    srcs[i] = input;
+                    continue;
+                }
+                T *reg = scratch + i * fused_block;
+                if (input_strides[i] == 0)
+                {
+                    std::fill_n(reg, m, *input);
+                }
+                else
+                {
+                    for (usize k = 0; k < m; k++)
+                    {
+                        reg[k] = input[k * input_strides[i]];
+                    }
+                }
+                srcs[i] = reg;
+            }
+            auto reg_ptr = [&](usize r) -> const T *
+            { return r < num_inputs ? srcs[r] : scratch + r * fused_block; };
+            for (usize j = 0; j < code.size(); j++)
+            {
+                T *dst = scratch + (num_inputs + j) * fused_block;
+                if (j + 1 == code.size() && output_stride == 1)
+                {
+                    dst = output + begin;
+                }
+                if (code[j].name == OpName::FULL)
+                {
+                    // Loads an immediate, whose bits are stored in place of the operands
+                    std::fill_n(dst, m, std::bit_cast<T>(static_cast<int32_t>(code[j].lhs)));
+                    continue;
+                }
+                fused_instr(code[j], reg_ptr(code[j].lhs), reg_ptr(code[j].rhs), dst, m);
+            }
+            if (output_stride != 1)
+            {
+                const T *result = reg_ptr(num_inputs + code.size() - 1);
+                for (usize k = 0; k < m; k++)
+                {
+                    output[static_cast<isize>(begin + k) * output_stride] = result[k];
+                }
+            }
+        }
+    }
+
+    // Runs a fused elementwise program, arrays are the inputs followed by the output and params hold one (op, lhs, rhs)
+    // triple per instruction. Registers are numbered with the inputs first, then one per instruction in order. A full
+    // instruction holds the bits of its value in place of the operands.
+    template <class T>
+    void fused_ss(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        constexpr usize N = max_fused_inputs + 1;
+        const usize num_inputs = arrs.size() - 1;
+        auto &out = arrs.back();
+        std::vector<FusedInstr> code;
+        for (usize i = 0; i + 2 < params.size(); i += 3)
+        {
+            code.push_back({static_cast<OpName>(params[i]), static_cast<usize>(params[i + 1]), static_cast<usize>(params[i + 2])});
+        }
+        // Unused slots take zero strides, which merge with any dimension
+        std::array<ShapeStride, N> strides;
+        strides[0] = out->get_stride();
+        for (usize i = 1; i < N; i++)
+        {
+            strides[i] = i <= num_inputs ? arrs[i - 1]->get_stride() : ShapeStride(out->get_ndim(), 0);
+        }
+        StridedIndexer<N> indexer(out->get_view(), strides, true);
+        std::vector<const T *> inputs;
+        std::array<isize, N> inner_strides;
+        for (usize i = 0; i < N; i++)
+        {
+            inner_strides[i] = indexer.get_inner_stride(i);
+        }
+        for (usize i = 0; i < num_inputs; i++)
+        {
+            inputs.push_back(typed_ptr<T>(arrs[i]));
+        }
+        T *output = typed_ptr<T>(out);
+        const usize scratch_size = (num_inputs + code.size()) * fused_block;
+        const usize n = indexer.get_inner_size();
+        if (indexer.get_num_rows() == 1)
+        {
+            parallel_for(0, n, elementwise_grain, [&](usize begin, usize end)
+                         {
+                std::vector<T> scratch(scratch_size);
+                std::vector<const T *> chunk = inputs;
+                for (usize i = 0; i < num_inputs; i++)
+                {
+                    chunk[i] += static_cast<isize>(begin) * inner_strides[i + 1];
+                }
+                fused_row(code, chunk, inner_strides.data() + 1, output + static_cast<isize>(begin) * inner_strides[0], inner_strides[0], end - begin, scratch.data()); });
+            return;
+        }
+        parallel_for(0, indexer.get_num_rows(), row_grain(n), [&](usize begin, usize end)
+                     {
+            std::vector<T> scratch(scratch_size);
+            std::vector<const T *> row(num_inputs);
+            indexer.for_each_row(begin, end, [&](const std::array<isize, N> &offsets)
+                                 {
+                for (usize i = 0; i < num_inputs; i++)
+                {
+                    row[i] = inputs[i] + offsets[i + 1];
+                }
+                fused_row(code, row, inner_strides.data() + 1, output + offsets[0], inner_strides[0], n, scratch.data()); }); });
+    }
+}
\ No newline at end of file
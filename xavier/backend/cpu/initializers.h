@@ -0,0 +1,36 @@
+#pragma once
+
+#include "utils.h"
+
+namespace xv::backend::cpu
+{
+    template <class T>
+    void full(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        auto output = typed_ptr<T>(arrs[0]);
+        auto c = static_cast<int>(params[0]);
+        T val;
+        if constexpr (std::is_same_v<T, float>)
+        {
+            val = std::bit_cast<float>(c);
+        }
+        else
+        {
+            val = static_cast<T>(c);
+        }
+        std::fill_n(output, arrs[0]->get_numel(), val);
+    }
+
+    template <class T>
+    void arange(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        auto output = typed_ptr<T>(arrs[0]);
+        auto start = params[0];
+        auto step = params[1];
+        auto numel = arrs[0]->get_numel();
+        for (usize i = 0; i < numel; i++)
+        {
+            output[i] = static_cast<T>(start + static_cast<isize>(i) * step);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#pragma once
+
+#include "simd.h"
+#include "parallel.h"
+#include "utils.h"
+
+namespace xv::backend::cpu
+{
+    // Blocking of the packed GEMM. The micro-kernel keeps an mr x nr tile of the output in 2 * mr vector registers,
+    // a kc x nr rhs micro-panel stays in L1, the packed mc x kc lhs block in L2 and the kc x nc rhs block in L3.
+    template <class T>
+    struct GemmBlocking
+    {
+#if defined(__AVX512F__)
+        static constexpr usize mr = 8; // 16 accumulators out of 32 zmm registers
+#else
+        static constexpr usize mr = 6; // 12 accumulators out of 16 ymm registers
+#endif
+        static constexpr usize nr = 2 * simd::Vec<T>::width;
+        static constexpr usize kc = 256;
+        static constexpr usize mc = 96;
+        static constexpr usize nc = 512;
+    };
+
+    // Copies an m x k block of lhs into mr-row panels stored column by column, padding the last panel with zeros
+    template <class T, class R>
+    void pack_lhs(const T *src, isize row_stride, isize col_stride, usize m, usize k, R *dst)
+    {
+        constexpr usize mr = GemmBlocking<R>::mr;
+        for (usize i = 0; i < m; i += mr)
+        {
+            const usize rows = std::min(mr, m - i);
+            for (usize p = 0; p < k; p++)
+            {
+                for (usize r = 0; r < rows; r++)
+                {
+                    dst[r] = static_cast<R>(src[(i + r) * row_stride + p * col_stride]);
+                }
+                std::fill(dst + rows, dst + mr, R(0));
+                dst += mr;
+            }
+        }
+    }
+
+    // Copies a k x n block of rhs into nr-column panels stored row by row, padding the last panel with zeros
+    template <class T, class R>
+    void pack_rhs(const T *src, isize row_stride, isize col_stride, usize k, usize n, R *dst)
+    {
+        constexpr usize nr = GemmBlocking<R>::nr;
+        for (usize j = 0; j < n; j += nr)
+        {
+            const usize cols = std::min(nr, n - j);
+            for (usize p = 0; p < k; p++)
+            {
+                auto row = src + p * row_stride + j * col_stride;
+                if (col_stride == 1)
+                {
+                    std::copy_n(row, cols, dst);
+                }
+                else
+                {
+                    for (usize c = 0; c < cols; c++)
+                    {
+                        dst[c] = static_cast<R>(row[c * col_stride]);
+                    }
+                }
+                std::fill(dst + cols, dst + nr, R(0));
+                dst += nr;
+            }
+        }
+    }
+
+    // Computes an m x n (at most mr x nr) output tile from packed panels, adding to the output unless it is the first k-block
+    template <class T>
+    inline void gemm_micro_kernel(usize kc, const T *a, const T *b, T *c, usize ldc, usize m, usize n, bool accumulate)
+    {
+        using Vec = simd::Vec<T>;
+        constexpr usize mr = GemmBlocking<T>::mr;
+        constexpr usize nr = GemmBlocking<T>::nr;
+        constexpr usize width = Vec::width;
+        constexpr usize nv = nr / width;
+        Vec acc[mr][nv];
+#pragma GCC unroll 8
+        for (usize r = 0; r < mr; r++)
+        {
+#pragma GCC unroll 4
+            for (usize v = 0; v < nv; v++)
+            {
+                acc[r][v] = Vec(T(0));
+            }
+        }
+        for (usize p = 0; p < kc; p++)
+        {
+            Vec bv[nv];
+#pragma GCC unroll 4
+            for (usize v = 0; v < nv; v++)
+            {
+                bv[v] = Vec::load(b + v * width);
+            }
+#pragma GCC unroll 8
+            for (usize r = 0; r < mr; r++)
+            {
+                const Vec av(a[r]);
+#pragma GCC unroll 4
+                for (usize v = 0; v < nv; v++)
+                {
+                    acc[r][v] = simd::fmadd(av, bv[v], acc[r][v]);
+                }
+            }
+            a += mr;
+            b += nr;
+        }
+        if (m == mr && n == nr)
+        {
+#pragma GCC unroll 8
+            for (usize r = 0; r < mr; r++)
+            {
+#pragma GCC unroll 4
+                for (usize v = 0; v < nv; v++)
+                {
+                    auto dst = c + r * ldc + v * width;
+                    (accumulate ? acc[r][v] + Vec::load(dst) : acc[r][v]).store(dst);
+                }
+            }
+            return;
+        }
+        // Edge tile goes through a buffer so that nothing outside the output is touched
+        T tile[mr * nr];
+        for (usize r = 0; r < mr; r++)
+        {
+            for (usize v = 0; v < nv; v++)
+            {
+                acc[r][v].store(tile + r * nr + v * width);
+            }
+        }
+        for (usize r = 0; r < m; r++)
+        {
+            for (usize j = 0; j < n; j++)
+            {
+                c[r * ldc + j] = accumulate ? c[r * ldc + j] + tile[r * nr + j] : tile[r * nr + j];
+            }
+        }
+    }
+
+    // Batched GEMM over (B, M, K) x (B, K, N) with arbitrary input strides and a contiguous output.
+    // Each task owns one mc x nc output tile of one batch and loops over k-blocks, packing both operands as it goes.
+    template <class T, class R>
+    void gemm(const T *lhs, const ShapeStride &lhs_stride, const T *rhs, const ShapeStride &rhs_stride, R *output,
+              usize B, usize M, usize K, usize N)
+    {
+        using Blocking = GemmBlocking<R>;
+        if (K == 0)
+        {
+            std::fill_n(output, B * M * N, R(0));
+            return;
+        }
+        const usize m_tiles = (M + Blocking::mc - 1) / Blocking::mc;
+        const usize n_tiles = (N + Blocking::nc - 1) / Blocking::nc;
+        // Keeps tiny products on the calling thread
+        const usize grain = std::max<usize>(1, (1 << 18) / std::max<usize>(1, std::min(M, Blocking::mc) * std::min(N, Blocking::nc) * K));
+        parallel_for(0, B * m_tiles * n_tiles, grain, [&](usize begin, usize end)
+                     {
+            thread_local std::vector<R> packed_lhs;
+            thread_local std::vector<R> packed_rhs;
+            packed_lhs.resize(Blocking::mc * Blocking::kc);
+            packed_rhs.resize(Blocking::kc * (Blocking::nc + Blocking::nr));
+            for (usize task = begin; task < end; task++)
+            {
+                const usize batch = task / (m_tiles * n_tiles);
+                const usize i0 = (task / n_tiles) % m_tiles * Blocking::mc;
+                const usize j0 = task % n_tiles * Blocking::nc;
+                const usize mc = std::min(Blocking::mc, M - i0);
+                const usize nc = std::min(Blocking::nc, N - j0);
+                auto lhs_mat = lhs + batch * lhs_stride[0] + i0 * lhs_stride[1];
+                auto rhs_mat = rhs + batch * rhs_stride[0] + j0 * rhs_stride[2];
+                auto out_mat = output + batch * M * N + i0 * N + j0;
+                for (usize p0 = 0; p0 < K; p0 += Blocking::kc)
+                {
+                    const usize kc = std::min(Blocking::kc, K - p0);
+                    pack_rhs(rhs_mat + p0 * rhs_stride[1], rhs_stride[1], rhs_stride[2], kc, nc, packed_rhs.data());
+                    pack_lhs(lhs_mat + p0 * lhs_stride[2], lhs_stride[1], lhs_stride[2], mc, kc, packed_lhs.data());
+                    for (usize j = 0; j < nc; j += Blocking::nr)
+                    {
+                        for (usize i = 0; i < mc; i += Blocking::mr)
+                        {
+                            gemm_micro_kernel(kc, packed_lhs.data() + i * kc, packed_rhs.data() + j * kc, out_mat + i * N + j, N,
+                                              std::min(Blocking::mr, mc - i), std::min(Blocking::nr, nc - j), p0 > 0);
+                        }
+                    }
+                }
+            } });
+    }
+
+    template <class T, class R>
+    void matmul_vv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto lhs = typed_ptr<T>(arrs[0]);
+        auto rhs = typed_ptr<T>(arrs[1]);
+        auto output = typed_ptr<R>(arrs[2]);
+        auto &lhs_view = arrs[0]->get_view();
+        auto &rhs_view = arrs[1]->get_view();
+        const usize B = lhs_view[0]; // Batch size
+        const usize M = lhs_view[1]; // Rows in each matrix
+        const usize K = lhs_view[2]; // Inner dimension
+        const usize N = rhs_view[2]; // Cols in each matrix
+        const ShapeStride lhs_stride = {static_cast<isize>(M * K), static_cast<isize>(K), 1};
+        const ShapeStride rhs_stride = {static_cast<isize>(K * N), static_cast<isize>(N), 1};
+        gemm(lhs, lhs_stride, rhs, rhs_stride, output, B, M, K, N);
+    }
+
+    template <class T, class R>
+    void matmul_vs(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto lhs = typed_ptr<T>(arrs[0]);
+        auto rhs = typed_ptr<T>(arrs[1]);
+        auto output = typed_ptr<R>(arrs[2]);
+        auto &lhs_view = arrs[0]->get_view();
+        auto &rhs_view = arrs[1]->get_view();
+        const usize B = lhs_view[0]; // Batch size
+        const usize M = lhs_view[1]; // Rows in each matrix
+        const usize K = lhs_view[2]; // Inner dimension
+        const usize N = rhs_view[2]; // Cols in each matrix
+        // Packing reads through the strides so transposed and batch-broadcast operands need no copy
+        gemm(lhs, arrs[0]->get_stride(), rhs, arrs[1]->get_stride(), output, B, M, K, N);
+    }
+}
\ No newline at end of file
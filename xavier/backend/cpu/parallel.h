@@ -0,0 +1,19 @@
+#pragma once
+
+#include "thread_pool.h"
+
+namespace xv::backend::cpu
+{
+    // Elementwise kernels below this many elements per chunk stay on the calling thread
+    inline constexpr usize elementwise_grain = 1 << 15;
+
+    // Number of rows of length n that make up one elementwise chunk
+    inline usize row_grain(usize n) { return std::max<usize>(1, elementwise_grain / std::max<usize>(n, 1)); }
+
+    // Runs fn(lo, hi) over chunks of at least grain indices of [begin, end) on the process-wide pool
+    template <class Fn>
+    void parallel_for(usize begin, usize end, usize grain, Fn &&fn)
+    {
+        get_thread_pool()->parallel_for(begin, end, grain, std::forward<Fn>(fn));
+    }
+}
\ No newline at end of file
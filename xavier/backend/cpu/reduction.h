@@ -0,0 +1,318 @@
+#pragma once
+
+#include "simd.h"
+#include "parallel.h"
+#include "utils.h"
+
+namespace xv::backend::cpu
+{
+    // Each reduction has an identity element, a scalar combine and a SIMD combine
+    struct Sum
+    {
+        template <class T>
+        static T identity() { return T(0); }
+
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs + rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return lhs + rhs; }
+    };
+
+    struct Max
+    {
+        template <class T>
+        static T identity()
+        {
+            if constexpr (std::numeric_limits<T>::has_infinity)
+            {
+                return -std::numeric_limits<T>::infinity();
+            }
+            return std::numeric_limits<T>::lowest();
+        }
+
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs <= rhs ? rhs : lhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return simd::max(lhs, rhs); }
+    };
+
+    struct Min
+    {
+        template <class T>
+        static T identity()
+        {
+            if constexpr (std::numeric_limits<T>::has_infinity)
+            {
+                return std::numeric_limits<T>::infinity();
+            }
+            return std::numeric_limits<T>::max();
+        }
+
+        template <class T>
+        T operator()(T lhs, T rhs) const { return lhs <= rhs ? lhs : rhs; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> lhs, simd::Vec<T> rhs) const { return simd::min(lhs, rhs); }
+    };
+
+    // Elements reduced by one thread before its partial is combined with the others
+    inline constexpr usize reduction_grain = 1 << 16;
+
+    // Reduces n elements on the calling thread, unit-stride input runs four vector accumulators to hide the op latency
+    template <class Op, class T, class R>
+    inline R reduce_row(const T *input, isize stride, usize n)
+    {
+        R val = Op::template identity<R>();
+        usize i = 0;
+        if constexpr (std::is_same_v<T, R>)
+        {
+            using Vec = simd::Vec<T>;
+            constexpr usize width = Vec::width;
+            if (stride == 1 && n >= 4 * width)
+            {
+                Vec acc0 = Vec::load(input);
+                Vec acc1 = Vec::load(input + width);
+                Vec acc2 = Vec::load(input + 2 * width);
+                Vec acc3 = Vec::load(input + 3 * width);
+                for (i = 4 * width; i + 4 * width <= n; i += 4 * width)
+                {
+                    acc0 = Op()(acc0, Vec::load(input + i));
+                    acc1 = Op()(acc1, Vec::load(input + i + width));
+                    acc2 = Op()(acc2, Vec::load(input + i + 2 * width));
+                    acc3 = Op()(acc3, Vec::load(input + i + 3 * width));
+                }
+                for (; i + width <= n; i += width)
+                {
+                    acc0 = Op()(acc0, Vec::load(input + i));
+                }
+                acc0 = Op()(Op()(acc0, acc1), Op()(acc2, acc3));
+                T lanes[width];
+                acc0.store(lanes);
+                for (usize j = 0; j < width; j++)
+                {
+                    val = Op()(val, lanes[j]);
+                }
+            }
+        }
+        for (; i < n; i++)
+        {
+            val = Op()(val, static_cast<R>(input[i * stride]));
+        }
+        return val;
+    }
+
+    // Combines partials pairwise, level by level, so no two threads ever write the same value
+    template <class Op, class R>
+    inline R combine_tree(std::vector<R> &partials)
+    {
+        for (usize step = 1; step < partials.size(); step *= 2)
+        {
+            for (usize i = 0; i + step < partials.size(); i += 2 * step)
+            {
+                partials[i] = Op()(partials[i], partials[i + step]);
+            }
+        }
+        return partials.empty() ? Op::template identity<R>() : partials[0];
+    }
+
+    // Reduces every row of the indexer into a single value. Rows are cut into chunks of about reduction_grain elements,
+    // each chunk writes its own partial.
+    template <class Op, class T, class R>
+    inline R reduce_rows(const T *input, const StridedIndexer<1> &indexer)
+    {
+        const usize rows = indexer.get_num_rows();
+        const usize n = indexer.get_inner_size();
+        const isize stride = indexer.get_inner_stride(0);
+        const usize max_chunks = std::max<usize>(1, 4 * get_num_workers());
+        const usize num_chunks = std::clamp<usize>(indexer.get_numel() / reduction_grain, 1, max_chunks);
+        auto reduce_chunk = [&](usize begin, usize end)
+        {
+            R val = Op::template identity<R>();
+            indexer.for_each_row(begin, end, [&](const std::array<isize, 1> &offsets)
+                                 { val = Op()(val, reduce_row<Op, T, R>(input + offsets[0], stride, n)); });
+            return val;
+        };
+        if (num_chunks == 1)
+        {
+            return reduce_chunk(0, rows);
+        }
+        std::vector<R> partials(num_chunks, Op::template identity<R>());
+        if (rows == 1)
+        {
+            // A single long row is cut within the row
+            const usize chunk = (n + num_chunks - 1) / num_chunks;
+            parallel_for(0, num_chunks, 1, [&](usize begin, usize end)
+                         {
+                for (usize c = begin; c < end; c++)
+                {
+                    const usize lo = std::min(n, c * chunk);
+                    const usize hi = std::min(n, lo + chunk);
+                    partials[c] = reduce_row<Op, T, R>(input + lo * stride, stride, hi - lo);
+                } });
+        }
+        else
+        {
+            const usize chunk = (rows + num_chunks - 1) / num_chunks;
+            parallel_for(0, num_chunks, 1, [&](usize begin, usize end)
+                         {
+                for (usize c = begin; c < end; c++)
+                {
+                    partials[c] = reduce_chunk(std::min(rows, c * chunk), std::min(rows, (c + 1) * chunk));
+                } });
+        }
+        return combine_tree<Op>(partials);
+    }
+
+    template <class Op, class T, class R>
+    void reduce_all_vv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        output[0] = reduce_rows<Op, T, R>(input, StridedIndexer<1>(ShapeView{arrs[0]->get_numel()}, {ShapeStride{1}}));
+    }
+
+    // The order of a full reduction does not matter, so the indexer sorts and merges the dimensions into as few rows as it can
+    template <class Op, class T, class R>
+    void reduce_all_vs(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        output[0] = reduce_rows<Op, T, R>(input, StridedIndexer<1>(arrs[0]->get_view(), {arrs[0]->get_stride()}, true));
+    }
+
+    // Combines a strided input row into an accumulator row element by element
+    template <class Op, class T, class R>
+    inline void accumulate_row(const T *input, isize stride, R *acc, isize acc_stride, usize n)
+    {
+        usize i = 0;
+        if constexpr (std::is_same_v<T, R>)
+        {
+            using Vec = simd::Vec<T>;
+            constexpr usize width = Vec::width;
+            if (stride == 1 && acc_stride == 1)
+            {
+                for (; i + width <= n; i += width)
+                {
+                    Op()(Vec::load(acc + i), Vec::load(input + i)).store(acc + i);
+                }
+            }
+        }
+        for (; i < n; i++)
+        {
+            acc[i * acc_stride] = Op()(acc[i * acc_stride], static_cast<R>(input[i * stride]));
+        }
+    }
+
+    // Reduces the given dims of an N-d strided input into an output that holds the kept dims in their original order.
+    // The traversal follows the strides instead of transposing: when the innermost dim is reduced each output
+    // reduces rows along it, otherwise input rows along the innermost kept dim are accumulated into output rows.
+    template <class Op, class T, class R>
+    void reduce_dims(const T *input, const ShapeView &view, const ShapeStride &stride, const std::vector<isize> &dims, R *output)
+    {
+        ShapeView kept_view, reduced_view;
+        ShapeStride kept_stride, reduced_stride;
+        for (usize d = 0; d < view.size(); d++)
+        {
+            if (std::find(dims.begin(), dims.end(), static_cast<isize>(d)) != dims.end())
+            {
+                reduced_view.push_back(view[d]);
+                reduced_stride.push_back(stride[d]);
+            }
+            else
+            {
+                kept_view.push_back(view[d]);
+                kept_stride.push_back(stride[d]);
+            }
+        }
+        ShapeStride out_stride(kept_view.size());
+        isize outputs = 1;
+        for (isize i = kept_view.size() - 1; i >= 0; i--)
+        {
+            out_stride[i] = outputs;
+            outputs *= kept_view[i];
+        }
+        // Both indexers sort by input strides, so their innermost dims are the ones with the smallest input strides
+        StridedIndexer<2> kept(kept_view, {kept_stride, out_stride}, true);
+        StridedIndexer<1> reduced(reduced_view, {reduced_stride}, true);
+
+        if (std::abs(reduced.get_inner_stride(0)) <= std::abs(kept.get_inner_stride(0)) || kept.get_numel() == 1)
+        {
+            const usize work = reduced.get_numel();
+            if (kept.get_numel() < get_num_workers() && work >= reduction_grain)
+            {
+                // Too few outputs to keep every worker busy, splits the reduction of each output instead
+                kept.for_each(0, kept.get_numel(), [&](const std::array<isize, 2> &offsets)
+                              { output[offsets[1]] = reduce_rows<Op, T, R>(input + offsets[0], reduced); });
+                return;
+            }
+            parallel_for(0, kept.get_numel(), row_grain(work), [&](usize begin, usize end)
+                         { kept.for_each(begin, end, [&](const std::array<isize, 2> &offsets)
+                                         {
+                R val = Op::template identity<R>();
+                reduced.for_each_row(0, reduced.get_num_rows(), [&](const std::array<isize, 1> &row)
+                                     { val = Op()(val, reduce_row<Op, T, R>(input + offsets[0] + row[0], reduced.get_inner_stride(0), reduced.get_inner_size())); });
+                output[offsets[1]] = val; }); });
+            return;
+        }
+
+        const usize n = kept.get_inner_size();
+        const isize in_row_stride = kept.get_inner_stride(0);
+        const isize out_row_stride = kept.get_inner_stride(1);
+        const usize rows = reduced.get_numel();
+        if (kept.get_num_rows() < get_num_workers() && rows > 1 && rows * n >= reduction_grain)
+        {
+            // Each chunk of reduced rows accumulates its own partial row, partial rows are then combined pairwise
+            const usize num_chunks = std::clamp<usize>(rows * n / reduction_grain, 1, std::min<usize>(rows, 4 * get_num_workers()));
+            const usize chunk = (rows + num_chunks - 1) / num_chunks;
+            std::vector<R> partials(num_chunks * n);
+            kept.for_each_row(0, kept.get_num_rows(), [&](const std::array<isize, 2> &offsets)
+                              {
+                parallel_for(0, num_chunks, 1, [&](usize begin, usize end)
+                             {
+                    for (usize c = begin; c < end; c++)
+                    {
+                        R *acc = partials.data() + c * n;
+                        std::fill(acc, acc + n, Op::template identity<R>());
+                        reduced.for_each(std::min(rows, c * chunk), std::min(rows, (c + 1) * chunk), [&](const std::array<isize, 1> &row)
+                                         { accumulate_row<Op, T, R>(input + offsets[0] + row[0], in_row_stride, acc, 1, n); });
+                    } });
+                for (usize step = 1; step < num_chunks; step *= 2)
+                {
+                    for (usize c = 0; c + step < num_chunks; c += 2 * step)
+                    {
+                        accumulate_row<Op, R, R>(partials.data() + (c + step) * n, 1, partials.data() + c * n, 1, n);
+                    }
+                }
+                for (usize i = 0; i < n; i++)
+                {
+                    output[offsets[1] + i * out_row_stride] = partials[i];
+                } });
+            return;
+        }
+        parallel_for(0, kept.get_num_rows(), row_grain(rows * n), [&](usize begin, usize end)
+                     { kept.for_each_row(begin, end, [&](const std::array<isize, 2> &offsets)
+                                         {
+                R *out = output + offsets[1];
+                for (usize i = 0; i < n; i++)
+                {
+                    out[i * out_row_stride] = Op::template identity<R>();
+                }
+                reduced.for_each(0, rows, [&](const std::array<isize, 1> &row)
+                                 { accumulate_row<Op, T, R>(input + offsets[0] + row[0], in_row_stride, out, out_row_stride, n); }); }); });
+    }
+
+    // Reduces the dims passed as params, see reduce_dims
+    template <class Op, class T, class R>
+    void reduce_dims_vv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        reduce_dims<Op, T, R>(typed_ptr<T>(arrs[0]), arrs[0]->get_view(), arrs[0]->get_shape().get_contiguous_stride(), params, typed_ptr<R>(arrs[1]));
+    }
+
+    template <class Op, class T, class R>
+    void reduce_dims_vs(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &params)
+    {
+        reduce_dims<Op, T, R>(typed_ptr<T>(arrs[0]), arrs[0]->get_view(), arrs[0]->get_stride(), params, typed_ptr<R>(arrs[1]));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "../../common.h"
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace xv::backend::cpu::simd
+{
+    using xv::core::usize;
+
+    // Portable fallback, one lane per vector so that kernels can be written once for every target
+    template <class T>
+    struct Vec
+    {
+        using Mask = bool;
+        static constexpr usize width = 1;
+        T v;
+
+        Vec() = default;
+        Vec(T c) : v(c) {}
+        static Vec load(const T *ptr) { return Vec(*ptr); }
+        void store(T *ptr) const { *ptr = v; }
+    };
+
+    template <class T>
+    inline Vec<T> operator+(Vec<T> a, Vec<T> b) { return a.v + b.v; }
+    template <class T>
+    inline Vec<T> operator-(Vec<T> a, Vec<T> b) { return a.v - b.v; }
+    template <class T>
+    inline Vec<T> operator*(Vec<T> a, Vec<T> b) { return a.v * b.v; }
+    template <class T>
+    inline Vec<T> operator/(Vec<T> a, Vec<T> b) { return a.v / b.v; }
+    template <class T>
+    inline Vec<T> operator-(Vec<T> a) { return -a.v; }
+    template <class T>
+    inline Vec<T> operator&(Vec<T> a, Vec<T> b) { return a.v & b.v; }
+    template <class T>
+    inline Vec<T> operator|(Vec<T> a, Vec<T> b) { return a.v | b.v; }
+    template <class T>
+    inline Vec<T> fmadd(Vec<T> a, Vec<T> b, Vec<T> c) { return a.v * b.v + c.v; }
+    template <class T>
+    inline Vec<T> min(Vec<T> a, Vec<T> b) { return a.v <= b.v ? a.v : b.v; }
+    template <class T>
+    inline Vec<T> max(Vec<T> a, Vec<T> b) { return a.v <= b.v ? b.v : a.v; }
+    template <class T>
+    inline Vec<T> sqrt(Vec<T> a) { return std::sqrt(a.v); }
+    template <class T>
+    inline Vec<T> round(Vec<T> a) { return std::nearbyint(a.v); }
+    template <class T>
+    inline bool eq(Vec<T> a, Vec<T> b) { return a.v == b.v; }
+    template <class T>
+    inline bool neq(Vec<T> a, Vec<T> b) { return a.v != b.v; }
+    template <class T>
+    inline bool lt(Vec<T> a, Vec<T> b) { return a.v < b.v; }
+    template <class T>
+    inline bool gt(Vec<T> a, Vec<T> b) { return a.v > b.v; }
+    template <class T>
+    inline bool leq(Vec<T> a, Vec<T> b) { return a.v <= b.v; }
+    template <class T>
+    inline bool geq(Vec<T> a, Vec<T> b) { return a.v >= b.v; }
+    template <class T>
+    inline Vec<T> select(bool mask, Vec<T> a, Vec<T> b) { return mask ? a : b; }
+    template <int n, class T>
+    inline Vec<T> shl(Vec<T> a) { return static_cast<T>(static_cast<uint32_t>(a.v) << n); }
+    template <int n, class T>
+    inline Vec<T> shr(Vec<T> a) { return static_cast<T>(static_cast<uint32_t>(a.v) >> n); }
+
+#if defined(__AVX512F__)
+    template <>
+    struct Vec<float>
+    {
+        using Mask = __mmask16;
+        static constexpr usize width = 16;
+        __m512 v;
+
+        Vec() = default;
+        Vec(__m512 v) : v(v) {}
+        Vec(float c) : v(_mm512_set1_ps(c)) {}
+        static Vec load(const float *ptr) { return _mm512_loadu_ps(ptr); }
+        void store(float *ptr) const { _mm512_storeu_ps(ptr, v); }
+    };
+
+    template <>
+    struct Vec<int32_t>
+    {
+        using Mask = __mmask16;
+        static constexpr usize width = 16;
+        __m512i v;
+
+        Vec() = default;
+        Vec(__m512i v) : v(v) {}
+        Vec(int32_t c) : v(_mm512_set1_epi32(c)) {}
+        static Vec load(const int32_t *ptr) { return _mm512_loadu_si512(ptr); }
+        void store(int32_t *ptr) const { _mm512_storeu_si512(ptr, v); }
+    };
+
+    inline Vec<float> operator+(Vec<float> a, Vec<float> b) { return _mm512_add_ps(a.v, b.v); }
+    inline Vec<float> operator-(Vec<float> a, Vec<float> b) { return _mm512_sub_ps(a.v, b.v); }
+    inline Vec<float> operator*(Vec<float> a, Vec<float> b) { return _mm512_mul_ps(a.v, b.v); }
+    inline Vec<float> operator/(Vec<float> a, Vec<float> b) { return _mm512_div_ps(a.v, b.v); }
+    inline Vec<float> operator-(Vec<float> a) { return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(0x80000000))); }
+    inline Vec<float> fmadd(Vec<float> a, Vec<float> b, Vec<float> c) { return _mm512_fmadd_ps(a.v, b.v, c.v); }
+    inline Vec<float> min(Vec<float> a, Vec<float> b) { return _mm512_min_ps(a.v, b.v); }
+    inline Vec<float> max(Vec<float> a, Vec<float> b) { return _mm512_max_ps(a.v, b.v); }
+    inline Vec<float> sqrt(Vec<float> a) { return _mm512_sqrt_ps(a.v); }
+    inline Vec<float> round(Vec<float> a) { return _mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline __mmask16 eq(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_EQ_OQ); }
+    inline __mmask16 neq(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_NEQ_UQ); }
+    inline __mmask16 lt(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+    inline __mmask16 gt(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ); }
+    inline __mmask16 leq(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ); }
+    inline __mmask16 geq(Vec<float> a, Vec<float> b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ); }
+    inline Vec<float> select(__mmask16 mask, Vec<float> a, Vec<float> b) { return _mm512_mask_blend_ps(mask, b.v, a.v); }
+
+    inline Vec<int32_t> operator+(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_add_epi32(a.v, b.v); }
+    inline Vec<int32_t> operator-(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_sub_epi32(a.v, b.v); }
+    inline Vec<int32_t> operator*(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_mullo_epi32(a.v, b.v); }
+    // No integer division instruction, the quotient of two int32 values is exact in double and truncates like C++
+    inline Vec<int32_t> operator/(Vec<int32_t> a, Vec<int32_t> b)
+    {
+        auto lo = _mm512_div_pd(_mm512_cvtepi32_pd(_mm512_castsi512_si256(a.v)), _mm512_cvtepi32_pd(_mm512_castsi512_si256(b.v)));
+        auto hi = _mm512_div_pd(_mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(a.v, 1)), _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(b.v, 1)));
+        return _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(lo)), _mm512_cvttpd_epi32(hi), 1);
+    }
+    inline Vec<int32_t> operator-(Vec<int32_t> a) { return _mm512_sub_epi32(_mm512_setzero_si512(), a.v); }
+    inline Vec<int32_t> operator&(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_and_si512(a.v, b.v); }
+    inline Vec<int32_t> operator|(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_or_si512(a.v, b.v); }
+    inline Vec<int32_t> fmadd(Vec<int32_t> a, Vec<int32_t> b, Vec<int32_t> c) { return a * b + c; }
+    inline Vec<int32_t> min(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_min_epi32(a.v, b.v); }
+    inline Vec<int32_t> max(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_max_epi32(a.v, b.v); }
+    inline __mmask16 eq(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmpeq_epi32_mask(a.v, b.v); }
+    inline __mmask16 neq(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmpneq_epi32_mask(a.v, b.v); }
+    inline __mmask16 lt(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmplt_epi32_mask(a.v, b.v); }
+    inline __mmask16 gt(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmpgt_epi32_mask(a.v, b.v); }
+    inline __mmask16 leq(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmple_epi32_mask(a.v, b.v); }
+    inline __mmask16 geq(Vec<int32_t> a, Vec<int32_t> b) { return _mm512_cmpge_epi32_mask(a.v, b.v); }
+    inline Vec<int32_t> select(__mmask16 mask, Vec<int32_t> a, Vec<int32_t> b) { return _mm512_mask_blend_epi32(mask, b.v, a.v); }
+    template <int n>
+    inline Vec<int32_t> shl(Vec<int32_t> a) { return _mm512_slli_epi32(a.v, n); }
+    template <int n>
+    inline Vec<int32_t> shr(Vec<int32_t> a) { return _mm512_srli_epi32(a.v, n); }
+
+    inline Vec<float> to_float(Vec<int32_t> a) { return _mm512_cvtepi32_ps(a.v); }
+    inline Vec<int32_t> to_int(Vec<float> a) { return _mm512_cvttps_epi32(a.v); }
+    inline Vec<float> bitcast_float(Vec<int32_t> a) { return _mm512_castsi512_ps(a.v); }
+    inline Vec<int32_t> bitcast_int(Vec<float> a) { return _mm512_castps_si512(a.v); }
+#elif defined(__AVX2__)
+    template <>
+    struct Vec<float>
+    {
+        using Mask = __m256;
+        static constexpr usize width = 8;
+        __m256 v;
+
+        Vec() = default;
+        Vec(__m256 v) : v(v) {}
+        Vec(float c) : v(_mm256_set1_ps(c)) {}
+        static Vec load(const float *ptr) { return _mm256_loadu_ps(ptr); }
+        void store(float *ptr) const { _mm256_storeu_ps(ptr, v); }
+    };
+
+    template <>
+    struct Vec<int32_t>
+    {
+        using Mask = __m256i;
+        static constexpr usize width = 8;
+        __m256i v;
+
+        Vec() = default;
+        Vec(__m256i v) : v(v) {}
+        Vec(int32_t c) : v(_mm256_set1_epi32(c)) {}
+        static Vec load(const int32_t *ptr) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr)); }
+        void store(int32_t *ptr) const { _mm256_storeu_si256(reinterpret_cast<__m256i *>(ptr), v); }
+    };
+
+    inline Vec<float> operator+(Vec<float> a, Vec<float> b) { return _mm256_add_ps(a.v, b.v); }
+    inline Vec<float> operator-(Vec<float> a, Vec<float> b) { return _mm256_sub_ps(a.v, b.v); }
+    inline Vec<float> operator*(Vec<float> a, Vec<float> b) { return _mm256_mul_ps(a.v, b.v); }
+    inline Vec<float> operator/(Vec<float> a, Vec<float> b) { return _mm256_div_ps(a.v, b.v); }
+    inline Vec<float> operator-(Vec<float> a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)); }
+#if defined(__FMA__)
+    inline Vec<float> fmadd(Vec<float> a, Vec<float> b, Vec<float> c) { return _mm256_fmadd_ps(a.v, b.v, c.v); }
+#else
+    inline Vec<float> fmadd(Vec<float> a, Vec<float> b, Vec<float> c) { return _mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v); }
+#endif
+    inline Vec<float> min(Vec<float> a, Vec<float> b) { return _mm256_min_ps(a.v, b.v); }
+    inline Vec<float> max(Vec<float> a, Vec<float> b) { return _mm256_max_ps(a.v, b.v); }
+    inline Vec<float> sqrt(Vec<float> a) { return _mm256_sqrt_ps(a.v); }
+    inline Vec<float> round(Vec<float> a) { return _mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+    inline __m256 eq(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ); }
+    inline __m256 neq(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_NEQ_UQ); }
+    inline __m256 lt(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    inline __m256 gt(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    inline __m256 leq(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    inline __m256 geq(Vec<float> a, Vec<float> b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    inline Vec<float> select(__m256 mask, Vec<float> a, Vec<float> b) { return _mm256_blendv_ps(b.v, a.v, mask); }
+
+    inline Vec<int32_t> operator+(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_add_epi32(a.v, b.v); }
+    inline Vec<int32_t> operator-(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_sub_epi32(a.v, b.v); }
+    inline Vec<int32_t> operator*(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_mullo_epi32(a.v, b.v); }
+    inline Vec<int32_t> operator/(Vec<int32_t> a, Vec<int32_t> b)
+    {
+        auto lo = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(a.v)), _mm256_cvtepi32_pd(_mm256_castsi256_si128(b.v)));
+        auto hi = _mm256_div_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(a.v, 1)), _mm256_cvtepi32_pd(_mm256_extracti128_si256(b.v, 1)));
+        return _mm256_set_m128i(_mm256_cvttpd_epi32(hi), _mm256_cvttpd_epi32(lo));
+    }
+    inline Vec<int32_t> operator-(Vec<int32_t> a) { return _mm256_sub_epi32(_mm256_setzero_si256(), a.v); }
+    inline Vec<int32_t> operator&(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_and_si256(a.v, b.v); }
+    inline Vec<int32_t> operator|(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_or_si256(a.v, b.v); }
+    inline Vec<int32_t> fmadd(Vec<int32_t> a, Vec<int32_t> b, Vec<int32_t> c) { return a * b + c; }
+    inline Vec<int32_t> min(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_min_epi32(a.v, b.v); }
+    inline Vec<int32_t> max(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_max_epi32(a.v, b.v); }
+    inline __m256i eq(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_cmpeq_epi32(a.v, b.v); }
+    inline __m256i neq(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_xor_si256(_mm256_cmpeq_epi32(a.v, b.v), _mm256_set1_epi32(-1)); }
+    inline __m256i lt(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_cmpgt_epi32(b.v, a.v); }
+    inline __m256i gt(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_cmpgt_epi32(a.v, b.v); }
+    inline __m256i leq(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_xor_si256(_mm256_cmpgt_epi32(a.v, b.v), _mm256_set1_epi32(-1)); }
+    inline __m256i geq(Vec<int32_t> a, Vec<int32_t> b) { return _mm256_xor_si256(_mm256_cmpgt_epi32(b.v, a.v), _mm256_set1_epi32(-1)); }
+    inline Vec<int32_t> select(__m256i mask, Vec<int32_t> a, Vec<int32_t> b) { return _mm256_blendv_epi8(b.v, a.v, mask); }
+    template <int n>
+    inline Vec<int32_t> shl(Vec<int32_t> a) { return _mm256_slli_epi32(a.v, n); }
+    template <int n>
+    inline Vec<int32_t> shr(Vec<int32_t> a) { return _mm256_srli_epi32(a.v, n); }
+
+    inline Vec<float> to_float(Vec<int32_t> a) { return _mm256_cvtepi32_ps(a.v); }
+    inline Vec<int32_t> to_int(Vec<float> a) { return _mm256_cvttps_epi32(a.v); }
+    inline Vec<float> bitcast_float(Vec<int32_t> a) { return _mm256_castsi256_ps(a.v); }
+    inline Vec<int32_t> bitcast_int(Vec<float> a) { return _mm256_castps_si256(a.v); }
+#else
+    inline Vec<float> to_float(Vec<int32_t> a) { return static_cast<float>(a.v); }
+    inline Vec<int32_t> to_int(Vec<float> a) { return static_cast<int32_t>(a.v); }
+    inline Vec<float> bitcast_float(Vec<int32_t> a) { return std::bit_cast<float>(a.v); }
+    inline Vec<int32_t> bitcast_int(Vec<float> a) { return std::bit_cast<int32_t>(a.v); }
+#endif
+
+    // Converts between lane types, float to int truncates like static_cast
+    template <class R, class T>
+    inline Vec<R> cast(Vec<T> a)
+    {
+        if constexpr (std::is_same_v<R, T>)
+        {
+            return a;
+        }
+        else if constexpr (std::is_same_v<R, float>)
+        {
+            return to_float(a);
+        }
+        else
+        {
+            return to_int(a);
+        }
+    }
+
+    // Cephes-style exp: e^x = 2^n * e^r with |r| <= ln(2)/2 and a degree-6 polynomial for e^r. 2^n is applied as two
+    // halves, which are normal floats even when the result is subnormal.
+    inline Vec<float> exp(Vec<float> x)
+    {
+        const Vec<float> hi(88.7228391116729996f);
+        const Vec<float> lo(-103.972077083991796f);
+        auto xc = min(max(x, lo), hi);
+        auto n = round(xc * Vec<float>(1.44269504088896341f));
+        auto r = fmadd(n, Vec<float>(-0.693359375f), xc);
+        r = fmadd(n, Vec<float>(2.12194440e-4f), r);
+        auto y = Vec<float>(1.9875691500e-4f);
+        y = fmadd(y, r, Vec<float>(1.3981999507e-3f));
+        y = fmadd(y, r, Vec<float>(8.3334519073e-3f));
+        y = fmadd(y, r, Vec<float>(4.1665795894e-2f));
+        y = fmadd(y, r, Vec<float>(1.6666665459e-1f));
+        y = fmadd(y, r, Vec<float>(5.0000001201e-1f));
+        y = fmadd(y, r * r, r) + Vec<float>(1.0f);
+        // Builds each half of 2^n from the exponent bits
+        auto n1 = to_int(n * Vec<float>(0.5f));
+        auto n2 = to_int(n) - n1;
+        auto result = y * bitcast_float(shl<23>(n1 + Vec<int32_t>(127))) * bitcast_float(shl<23>(n2 + Vec<int32_t>(127)));
+        result = select(gt(x, hi), Vec<float>(std::numeric_limits<float>::infinity()), result);
+        result = select(lt(x, lo), Vec<float>(0.0f), result);
+        // NaN propagates
+        return select(neq(x, x), x, result);
+    }
+
+    // Cephes-style log: splits x into m * 2^e with m in [sqrt(0.5), sqrt(2)) and a degree-8 polynomial for log(m)
+    inline Vec<float> log(Vec<float> x)
+    {
+        // Subnormals are scaled by 2^23 into the normal range, which the exponent then takes back
+        auto subnormal = lt(x, Vec<float>(std::numeric_limits<float>::min()));
+        auto xc = select(subnormal, x * Vec<float>(8388608.0f), x);
+        auto bits = bitcast_int(xc);
+        auto e = to_float(shr<23>(bits) - Vec<int32_t>(126));
+        e = select(subnormal, e - Vec<float>(23.0f), e);
+        auto m = bitcast_float((bits & Vec<int32_t>(0x007fffff)) | Vec<int32_t>(0x3f000000));
+        auto small = lt(m, Vec<float>(0.707106781186547524f));
+        e = select(small, e - Vec<float>(1.0f), e);
+        m = select(small, m + m - Vec<float>(1.0f), m - Vec<float>(1.0f));
+        auto z = m * m;
+        auto y = Vec<float>(7.0376836292e-2f);
+        y = fmadd(y, m, Vec<float>(-1.1514610310e-1f));
+        y = fmadd(y, m, Vec<float>(1.1676998740e-1f));
+        y = fmadd(y, m, Vec<float>(-1.2420140846e-1f));
+        y = fmadd(y, m, Vec<float>(1.4249322787e-1f));
+        y = fmadd(y, m, Vec<float>(-1.6668057665e-1f));
+        y = fmadd(y, m, Vec<float>(2.0000714765e-1f));
+        y = fmadd(y, m, Vec<float>(-2.4999993993e-1f));
+        y = fmadd(y, m, Vec<float>(3.3333331174e-1f));
+        y = y * m * z;
+        y = fmadd(e, Vec<float>(-2.12194440e-4f), y);
+        y = fmadd(z, Vec<float>(-0.5f), y);
+        auto result = fmadd(e, Vec<float>(0.693359375f), m + y);
+        const float inf = std::numeric_limits<float>::infinity();
+        result = select(eq(x, Vec<float>(0.0f)), Vec<float>(-inf), result);
+        result = select(eq(x, Vec<float>(inf)), x, result);
+        result = select(lt(x, Vec<float>(0.0f)), Vec<float>(std::numeric_limits<float>::quiet_NaN()), result);
+        return select(neq(x, x), x, result);
+    }
+}
\ No newline at end of file
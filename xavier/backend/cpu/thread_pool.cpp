@@ -0,0 +1,261 @@
+#include "thread_pool.h"
+
+namespace xv::backend::cpu
+{
+    namespace
+    {
+        // Index of the current thread in the pool that owns it
+        thread_local ThreadPool *current_pool = nullptr;
+        thread_local usize current_idx = 0;
+
+        std::shared_ptr<ThreadPool> default_pool;
+        std::mutex default_pool_mutex;
+        // Bumped whenever the pool is replaced, so each thread can keep the pool it last took without the lock
+        std::atomic<usize> default_pool_version = 1;
+
+        struct CachedPool
+        {
+            usize version = 0;
+            std::weak_ptr<ThreadPool> pool;
+        };
+        thread_local CachedPool cached_pool;
+
+        void delete_pool(ThreadPool *pool)
+        {
+            // A worker cannot join itself, so a run dropping the last reference on one of the workers hands the pool to
+            // another thread
+            if (current_pool == pool)
+            {
+                std::thread([pool]()
+                            { delete pool; })
+                    .detach();
+                return;
+            }
+            delete pool;
+        }
+
+        std::shared_ptr<ThreadPool> make_pool(usize num_workers)
+        {
+            return std::shared_ptr<ThreadPool>(new ThreadPool(num_workers), delete_pool);
+        }
+    }
+
+    bool WorkStealingDeque::push(Task *task)
+    {
+        isize b = bottom.load(std::memory_order_relaxed);
+        isize t = top.load(std::memory_order_acquire);
+        if (b - t >= capacity)
+        {
+            return false;
+        }
+        buffer[b & (capacity - 1)].store(task, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    Task *WorkStealingDeque::pop()
+    {
+        isize b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        isize t = top.load(std::memory_order_relaxed);
+        if (t > b)
+        {
+            // Empty
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Task *task = buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+        if (t == b)
+        {
+            // Last task, races with thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                task = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    Task *WorkStealingDeque::steal()
+    {
+        isize t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        isize b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return nullptr;
+        }
+        Task *task = buffer[t & (capacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return task;
+    }
+
+    ThreadPool::ThreadPool(usize num_workers) : num_workers(std::max<usize>(1, num_workers))
+    {
+        if (num_workers <= 1)
+        {
+            return;
+        }
+        for (usize i = 0; i < num_workers; i++)
+        {
+            deques.push_back(std::make_unique<WorkStealingDeque>());
+        }
+        for (usize i = 0; i < num_workers; i++)
+        {
+            workers.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        for (auto task : injected)
+        {
+            delete task;
+        }
+    }
+
+    void ThreadPool::submit(Task *task)
+    {
+        if (num_workers == 1)
+        {
+            (*task)();
+            delete task;
+            return;
+        }
+        pending.fetch_add(1, std::memory_order_release);
+        if (current_pool == this && deques[current_idx]->push(task))
+        {
+            // Taking the lock orders the pending update before a sleeping worker rechecks it
+            std::lock_guard<std::mutex> lock(mutex);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            injected.push_back(task);
+        }
+        cv.notify_one();
+    }
+
+    Task *ThreadPool::find_task()
+    {
+        const usize n = deques.size();
+        usize start = 0;
+        if (current_pool == this)
+        {
+            if (auto task = deques[current_idx]->pop())
+            {
+                return task;
+            }
+            start = current_idx + 1;
+        }
+        for (usize i = 0; i < n; i++)
+        {
+            if (auto task = deques[(start + i) % n]->steal())
+            {
+                return task;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!injected.empty())
+        {
+            auto task = injected.front();
+            injected.pop_front();
+            return task;
+        }
+        return nullptr;
+    }
+
+    bool ThreadPool::run_one()
+    {
+        if (num_workers == 1 || pending.load(std::memory_order_acquire) == 0)
+        {
+            return false;
+        }
+        auto task = find_task();
+        if (task == nullptr)
+        {
+            return false;
+        }
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+        (*task)();
+        delete task;
+        return true;
+    }
+
+    void ThreadPool::worker_loop(usize idx)
+    {
+        current_pool = this;
+        current_idx = idx;
+        while (true)
+        {
+            if (run_one())
+            {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]()
+                    { return stop || pending.load(std::memory_order_acquire) > 0; });
+            // Queued tasks still run after stop, their futures would never resolve otherwise
+            if (stop && pending.load(std::memory_order_acquire) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    std::shared_ptr<ThreadPool> get_thread_pool()
+    {
+        auto version = default_pool_version.load(std::memory_order_acquire);
+        if (cached_pool.version == version)
+        {
+            if (auto pool = cached_pool.pool.lock())
+            {
+                return pool;
+            }
+        }
+        std::lock_guard<std::mutex> lock(default_pool_mutex);
+        if (default_pool == nullptr)
+        {
+            default_pool = make_pool(std::thread::hardware_concurrency());
+        }
+        cached_pool = {default_pool_version.load(std::memory_order_relaxed), default_pool};
+        return default_pool;
+    }
+
+    void set_num_workers(usize num_workers)
+    {
+        if (num_workers == 0)
+        {
+            throw std::invalid_argument("Number of workers must be positive.");
+        }
+        if (current_pool != nullptr)
+        {
+            throw std::runtime_error("Number of workers cannot be changed from a worker thread.");
+        }
+        auto pool = make_pool(num_workers);
+        {
+            std::lock_guard<std::mutex> lock(default_pool_mutex);
+            std::swap(default_pool, pool);
+            default_pool_version.fetch_add(1, std::memory_order_release);
+        }
+        // The old pool drains and joins its workers outside the lock, unless a run still holds it
+        pool = nullptr;
+    }
+
+    usize get_num_workers() { return get_thread_pool()->get_num_workers(); }
+}
\ No newline at end of file
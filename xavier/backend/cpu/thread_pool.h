@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include "../../common.h"
+
+namespace xv::backend::cpu
+{
+    using xv::core::isize;
+    using xv::core::usize;
+
+    using Task = std::function<void()>;
+
+    // Chase-Lev deque: the owning worker pushes and pops at the bottom while other threads steal from the top
+    class WorkStealingDeque
+    {
+    private:
+        static constexpr isize capacity = 1 << 12;
+        alignas(64) std::atomic<isize> top = 0;
+        alignas(64) std::atomic<isize> bottom = 0;
+        std::unique_ptr<std::atomic<Task *>[]> buffer = std::make_unique<std::atomic<Task *>[]>(capacity);
+
+    public:
+        // Returns false when the deque is full, the caller then runs the task itself
+        bool push(Task *task);
+
+        Task *pop();
+
+        Task *steal();
+    };
+
+    class ThreadPool
+    {
+    private:
+        usize num_workers;
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkStealingDeque>> deques;
+        // Tasks submitted from threads outside the pool
+        std::deque<Task *> injected;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::atomic<usize> pending = 0;
+        std::atomic<bool> stop = false;
+
+        void worker_loop(usize idx);
+
+        Task *find_task();
+
+    public:
+        // Spawns num_workers threads, a pool with a single worker runs everything on the calling thread
+        ThreadPool(usize num_workers);
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        // Runs the tasks still queued before joining the workers
+        ~ThreadPool();
+
+        usize get_num_workers() const { return num_workers; }
+
+        void submit(Task *task);
+
+        // Runs one queued task if there is any, used by threads that wait on work they have submitted
+        bool run_one();
+
+        // Runs fn(lo, hi) over chunks of [begin, end), splitting ranges larger than grain in halves that idle workers steal.
+        // Returns once every chunk is done, the calling thread works on chunks while it waits.
+        template <class Fn>
+        void parallel_for(usize begin, usize end, usize grain, Fn &&fn);
+    };
+
+    // Process-wide pool. Holding the pointer keeps the pool alive after set_num_workers replaces it.
+    std::shared_ptr<ThreadPool> get_thread_pool();
+
+    // Replaces the process-wide pool. Work already on the old pool finishes there and later kernels go to the new one.
+    // Cannot be called from a worker.
+    void set_num_workers(usize num_workers);
+
+    usize get_num_workers();
+
+    template <class Fn>
+    void ThreadPool::parallel_for(usize begin, usize end, usize grain, Fn &&fn)
+    {
+        grain = std::max<usize>(grain, 1);
+        if (end <= begin + grain || num_workers == 1)
+        {
+            fn(begin, end);
+            return;
+        }
+        struct Range
+        {
+            ThreadPool *pool;
+            std::remove_reference_t<Fn> *fn;
+            usize grain;
+            std::atomic<usize> remaining;
+
+            void run(std::shared_ptr<Range> self, usize lo, usize hi)
+            {
+                // Hands out the upper halves and keeps the lowest chunk
+                while (hi - lo > grain)
+                {
+                    usize mid = lo + (hi - lo) / 2;
+                    pool->submit(new Task([self, mid, hi]()
+                                          { self->run(self, mid, hi); }));
+                    hi = mid;
+                }
+                (*fn)(lo, hi);
+                remaining.fetch_sub(hi - lo, std::memory_order_acq_rel);
+            }
+        };
+        auto range = std::make_shared<Range>(this, &fn, grain, end - begin);
+        range->run(range, begin, end);
+        while (range->remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "simd.h"
+#include "parallel.h"
+#include "utils.h"
+
+namespace xv::backend::cpu
+{
+    // Each functor has a scalar and a SIMD overload, ops producing floats convert integer lanes first
+    struct Identity
+    {
+        template <class T>
+        T operator()(T x) const { return x; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> x) const { return x; }
+    };
+
+    struct Exp
+    {
+        template <class T>
+        float operator()(T x) const { return std::exp(static_cast<float>(x)); }
+
+        template <class T>
+        simd::Vec<float> operator()(simd::Vec<T> x) const { return simd::exp(simd::cast<float>(x)); }
+    };
+
+    struct Log
+    {
+        template <class T>
+        float operator()(T x) const { return std::log(static_cast<float>(x)); }
+
+        template <class T>
+        simd::Vec<float> operator()(simd::Vec<T> x) const { return simd::log(simd::cast<float>(x)); }
+    };
+
+    struct Neg
+    {
+        template <class T>
+        T operator()(T x) const { return -x; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> x) const { return -x; }
+    };
+
+    struct Recip
+    {
+        template <class T>
+        float operator()(T x) const { return 1.0f / x; }
+
+        template <class T>
+        simd::Vec<float> operator()(simd::Vec<T> x) const { return simd::Vec<float>(1.0f) / simd::cast<float>(x); }
+    };
+
+    struct Sqrt
+    {
+        template <class T>
+        float operator()(T x) const { return std::sqrt(static_cast<float>(x)); }
+
+        template <class T>
+        simd::Vec<float> operator()(simd::Vec<T> x) const { return simd::sqrt(simd::cast<float>(x)); }
+    };
+
+    struct Sq
+    {
+        template <class T>
+        T operator()(T x) const { return x * x; }
+
+        template <class T>
+        simd::Vec<T> operator()(simd::Vec<T> x) const { return x * x; }
+    };
+
+    // Applies the op to n elements, vectorized when both sides are unit-stride and with a pointer walk otherwise
+    template <class Op, class T, class R>
+    inline void unary_row(const T *input, isize input_stride, R *output, isize output_stride, usize n)
+    {
+        usize i = 0;
+        if (input_stride == 1 && output_stride == 1)
+        {
+            constexpr usize width = simd::Vec<T>::width;
+            for (; i + width <= n; i += width)
+            {
+                simd::cast<R>(Op()(simd::Vec<T>::load(input + i))).store(output + i);
+            }
+            // Scalar tail
+            for (; i < n; i++)
+            {
+                output[i] = static_cast<R>(Op()(input[i]));
+            }
+            return;
+        }
+        for (; i < n; i++)
+        {
+            output[i * output_stride] = static_cast<R>(Op()(input[i * input_stride]));
+        }
+    }
+
+    // Unary operations for scalar-scalar
+    template <class Op, class T, class R>
+    void unary_ss_vv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        parallel_for(0, arrs[0]->get_numel(), elementwise_grain, [&](usize begin, usize end)
+                     { unary_row<Op>(input + begin, 1, output + begin, 1, end - begin); });
+    }
+
+    // The strided modes walk both arrays one row at a time through a shared indexer ordered by the output strides,
+    // dimensions that merge into one leave a single row that is split across threads
+    template <class Op, class T, class R>
+    void unary_rows(const T *input, const ShapeStride &input_stride, R *output, const ShapeStride &output_stride, const ShapeView &view)
+    {
+        StridedIndexer<2> indexer(view, {output_stride, input_stride}, true);
+        const usize n = indexer.get_inner_size();
+        const isize os = indexer.get_inner_stride(0);
+        const isize is = indexer.get_inner_stride(1);
+        if (indexer.get_num_rows() == 1)
+        {
+            parallel_for(0, n, elementwise_grain, [&](usize begin, usize end)
+                         { unary_row<Op>(input + begin * is, is, output + begin * os, os, end - begin); });
+            return;
+        }
+        parallel_for(0, indexer.get_num_rows(), row_grain(n), [&](usize begin, usize end)
+                     { indexer.for_each_row(begin, end, [&](const std::array<isize, 2> &offsets)
+                                            { unary_row<Op>(input + offsets[1], is, output + offsets[0], os, n); }); });
+    }
+
+    template <class Op, class T, class R>
+    void unary_ss_sv(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        // The contiguous side takes the view of the strided side, a reshape copy has different views on each side
+        unary_rows<Op>(input, arrs[1]->get_shape().get_contiguous_stride(), output, arrs[1]->get_stride(), arrs[1]->get_view());
+    }
+
+    template <class Op, class T, class R>
+    void unary_ss_vs(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        unary_rows<Op>(input, arrs[0]->get_stride(), output, arrs[0]->get_shape().get_contiguous_stride(), arrs[0]->get_view());
+    }
+
+    template <class Op, class T, class R>
+    void unary_ss_ss(const std::vector<ArrayPtr> &arrs, const std::vector<isize> &)
+    {
+        auto input = typed_ptr<T>(arrs[0]);
+        auto output = typed_ptr<R>(arrs[1]);
+        unary_rows<Op>(input, arrs[0]->get_stride(), output, arrs[1]->get_stride(), arrs[0]->get_view());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "../../core/array.h"
+#include "../../core/iter.h"
+
+namespace xv::backend::cpu
+{
+    using namespace xv::core;
+
+    template <class T>
+    inline T *typed_ptr(ArrayPtr arr) { return reinterpret_cast<T *>(arr->get_ptr()); }
+}
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <iomanip>
 #include <numeric>
 #include <cstdlib>
+#include <cstring>
 #include <cmath>
 #include <unordered_set>
 #include <unordered_map>
@@ -1,6 +1,9 @@
 #pragma once
 
 #include "../common.h"
+#include <atomic>
+#include <bit>
+#include <mutex>
 #include "buffer.h"
 
 namespace xv::core
@@ -9,7 +12,10 @@ namespace xv::core
     struct Allocator
     {
     protected:
-        usize allocated = 0;
+        // Bytes handed out to live buffers and held from the system, including cached blocks. Updated under the lock of
+        // the allocator but read without it while graphs run on other threads.
+        std::atomic<usize> allocated = 0;
+        std::atomic<usize> reserved = 0;
 
     public:
         Allocator() = default;
@@ -17,16 +23,85 @@ namespace xv::core
         Allocator &operator=(const Allocator &) = delete;
         virtual std::shared_ptr<Buffer> alloc(usize nbytes) = 0;
         virtual void free(std::shared_ptr<Buffer> buff) = 0;
-        usize get_allocated() const { return allocated; }
+        // Returns cached blocks to the system
+        virtual void empty_cache() = 0;
+        usize get_allocated() const { return allocated.load(std::memory_order_relaxed); }
+        usize get_reserved() const { return reserved.load(std::memory_order_relaxed); }
     };
 
-    struct CommonAllocator : public Allocator
+    // Caches freed blocks in free lists by size class so repeated forward passes reuse them instead of paying for
+    // malloc and page faults again. Blocks are 64-byte aligned for AVX-512 loads.
+    struct CachingAllocator : public Allocator
     {
+    private:
+        static constexpr usize alignment = 64;
+        // Sizes up to this are rounded to a power of two, larger ones to a multiple of it
+        static constexpr usize large_size = 1 << 20;
+        // Metal kernels accumulate into their outputs and expect zeroed buffers
+        bool zero_fill;
+        std::unordered_map<usize, std::vector<uint8_t *>> free_blocks;
+        std::mutex mutex;
+
+        static usize size_class(usize nbytes)
+        {
+            if (nbytes <= large_size)
+            {
+                return std::bit_ceil(std::max(nbytes, alignment));
+            }
+            return (nbytes + large_size - 1) / large_size * large_size;
+        }
+
+        void release_cached()
+        {
+            for (auto &[size, blocks] : free_blocks)
+            {
+                for (auto ptr : blocks)
+                {
+                    std::free(ptr);
+                    reserved -= size;
+                }
+            }
+            free_blocks.clear();
+        }
+
+    public:
+        CachingAllocator(bool zero_fill = false) : zero_fill(zero_fill) {}
+
+        ~CachingAllocator() { release_cached(); }
+
         std::shared_ptr<Buffer> alloc(usize nbytes) override
         {
-            allocated += nbytes;
-            auto ptr = new uint8_t[nbytes];
-            std::memset(ptr, 0, nbytes);
+            const usize size = size_class(nbytes);
+            uint8_t *ptr = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto &blocks = free_blocks[size];
+                if (!blocks.empty())
+                {
+                    ptr = blocks.back();
+                    blocks.pop_back();
+                }
+                else
+                {
+                    ptr = static_cast<uint8_t *>(std::aligned_alloc(alignment, size));
+                    if (ptr == nullptr)
+                    {
+                        // Out of memory, retries once without the cache
+                        release_cached();
+                        ptr = static_cast<uint8_t *>(std::aligned_alloc(alignment, size));
+                        if (ptr == nullptr)
+                        {
+                            throw std::bad_alloc();
+                        }
+                    }
+                    reserved += size;
+                }
+                allocated += size;
+            }
+            if (zero_fill)
+            {
+                std::memset(ptr, 0, nbytes);
+            }
             return std::make_shared<Buffer>(ptr, nbytes, true);
         }
 
@@ -34,16 +109,29 @@ namespace xv::core
         {
             if (buff->is_root())
             {
-                allocated -= buff->get_nbytes();
-                delete[] buff->get_ptr();
+                const usize size = size_class(buff->get_nbytes());
+                std::lock_guard<std::mutex> lock(mutex);
+                allocated -= size;
+                free_blocks[size].push_back(buff->get_ptr());
             }
         }
+
+        void empty_cache() override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            release_cached();
+        }
     };
 
+    // Allocator for the CPU backend
+    inline Allocator *cpu_allocator0 = new CachingAllocator();
+
 #if __APPLE__
     // Allocator for both CPU and MPS
-    inline Allocator *allocator0 = new CommonAllocator();
+    inline Allocator *allocator0 = new CachingAllocator(true);
 #else
     // TODO: implement for other platforms such as CUDA
+    // Without a GPU backend, the default allocator is the CPU one
+    inline Allocator *allocator0 = cpu_allocator0;
 #endif
 }
\ No newline at end of file
@@ -39,26 +39,14 @@ namespace xv::core
 
     uint8_t *Array::strided_idx(usize k) const
     {
-        if (is_contiguous())
-        {
-            return get_ptr() + k * get_itemsize();
-        }
-        std::vector<usize> idx(get_ndim());
-        usize carry = k;
-        usize tmp;
-        for (int i = get_ndim() - 1; i >= 0; i--)
-        {
-            tmp = carry;
-            idx[i] = tmp % shape[i];
-            carry = tmp / shape[i];
-        }
         auto &stride = get_stride();
-        auto ptr = get_ptr();
-        for (size_t i = 0; i < idx.size(); i++)
+        isize idx = 0;
+        for (isize i = get_ndim() - 1; i >= 0; i--)
         {
-            ptr += idx[i] * stride[i] * get_itemsize();
+            idx += static_cast<isize>(k % shape[i]) * stride[i];
+            k /= shape[i];
         }
-        return ptr;
+        return get_ptr() + idx * get_itemsize();
     }
 
     const std::string Array::str() const
@@ -87,13 +75,11 @@ namespace xv::core
             auto ptr = iter->next();
             // std::cout << std::hex << static_cast<void *>(ptr) << std::endl;
             s += fmt(ptr, dtype);
-            for (int i = elms_per_dim.size() - 1; i >= 0; i--)
+            // A dimension can only close after every inner one has closed
+            for (int i = elms_per_dim.size() - 1; i >= 0 && iter->count() % elms_per_dim[i] == 0; i--)
             {
-                if (iter->count() % elms_per_dim[i] == 0)
-                {
-                    s += "]";
-                    close += 1;
-                }
+                s += "]";
+                close += 1;
             }
             flag = iter->has_next();
             if (flag)
@@ -178,6 +164,15 @@ namespace xv::core
         return arr;
     }
 
+    ArrayPtr Array::placeholder(const ShapeView &view, const Dtype &dtype, const Device &device)
+    {
+        auto op = std::make_shared<PlaceholderOp>();
+        auto arr = std::make_shared<Array>(Shape(view), dtype, device);
+        arr->op = op;
+        arr->requires_grad = false;
+        return arr;
+    }
+
     ArrayPtr Array::matmul(ArrayPtr rhs)
     {
         auto dummy_op = std::make_shared<MatmulOp>(nullptr, nullptr);
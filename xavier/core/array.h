@@ -22,6 +22,7 @@ namespace xv::core
         std::shared_ptr<Buffer> buff = nullptr;
         std::shared_ptr<Op> op = nullptr;
         bool constant;
+        bool requires_grad = true;
 
         template <class I, class F>
         std::string fmt_num(uint8_t *ptr, Dtype dtype) const
@@ -157,21 +158,39 @@ namespace xv::core
         }
 
         template <class O>
-        ArrayPtr reduce(const std::vector<usize> &dims)
+        ArrayPtr reduce(const std::vector<usize> &dims, bool keepdim)
         {
-            ArrayPtr arr;
-            if (dims.size() == 0)
+            std::vector<usize> sorted_dims = dims;
+            std::sort(sorted_dims.begin(), sorted_dims.end());
+            sorted_dims.erase(std::unique(sorted_dims.begin(), sorted_dims.end()), sorted_dims.end());
+            if (!sorted_dims.empty() && sorted_dims.back() >= get_ndim())
             {
-                // Reduce to one element
-                arr = std::make_shared<Array>(Shape({1}), dtype, device);
+                throw std::invalid_argument("Cannot reduce dimension " + std::to_string(sorted_dims.back()) +
+                                            " of array with " + std::to_string(get_ndim()) + " dimensions.");
+            }
+            ShapeView reduced_view;
+            if (!sorted_dims.empty())
+            {
+                // Reduced dimensions are kept as 1s or dropped
+                for (usize i = 0; i < get_ndim(); i++)
+                {
+                    if (!std::binary_search(sorted_dims.begin(), sorted_dims.end(), i))
+                    {
+                        reduced_view.push_back(get_view()[i]);
+                    }
+                    else if (keepdim)
+                    {
+                        reduced_view.push_back(1);
+                    }
+                }
             }
-            else
+            if (reduced_view.empty())
             {
-                // Assume 2D matrix for now
-                Shape reduced_shape({get_view()[0], 1});
-                arr = std::make_shared<Array>(reduced_shape, dtype, device);
+                // Reduce to one element
+                reduced_view.push_back(1);
             }
-            arr->op = std::make_shared<O>(shared_from_this(), dims);
+            auto arr = std::make_shared<Array>(Shape(reduced_view), dtype, device);
+            arr->op = std::make_shared<O>(shared_from_this(), sorted_dims, keepdim);
             return arr;
         }
 
@@ -180,9 +199,38 @@ namespace xv::core
 
         void check_dims(usize start_dim, usize end_dim) const;
 
+        // Drops a reference to an op. The ops freed while an op is being destroyed are destroyed after it instead of from
+        // within, so dropping a long chain of arrays does not recurse through each operand.
+        static void release(std::shared_ptr<Op> op)
+        {
+            // Ops the outermost release on this thread has yet to drop
+            thread_local std::vector<std::shared_ptr<Op>> *pending = nullptr;
+            if (op == nullptr)
+            {
+                return;
+            }
+            if (pending != nullptr)
+            {
+                pending->push_back(std::move(op));
+                return;
+            }
+            std::vector<std::shared_ptr<Op>> ops;
+            ops.push_back(std::move(op));
+            pending = &ops;
+            while (!ops.empty())
+            {
+                auto last = std::move(ops.back());
+                ops.pop_back();
+                last = nullptr;
+            }
+            pending = nullptr;
+        }
+
     public:
         ArrayPtr grad = nullptr;
         ArrayPtr grad_root = nullptr;
+        // Dense index given by the last graph that reached the array while compiling, only meaningful to that graph
+        usize index = 0;
 
         Array(uint8_t *ptr, usize nbytes, const Shape &shape, const Dtype &dtype = f32, const Device &device = device0, bool constant = false) : id(id_gen.generate()), shape(shape), dtype(dtype), device(device), constant(constant)
         {
@@ -199,6 +247,7 @@ namespace xv::core
             {
                 device.get_allocator()->free(buff);
             }
+            release(std::move(op));
         }
 
         // Only allocate if the buffer is null
@@ -210,6 +259,16 @@ namespace xv::core
             }
         }
 
+        // Frees the buffer, the next kernel writing to the array allocates it again
+        void dealloc()
+        {
+            if (buff != nullptr)
+            {
+                device.get_allocator()->free(buff);
+                buff = nullptr;
+            }
+        }
+
         // Low overhead by pointing to another buffer
         void alloc(Buffer &buff)
         {
@@ -222,12 +281,8 @@ namespace xv::core
         void init_grad(bool is_root = false)
         {
             // This method only initializes the gradient array without allocating any new buffer for the data
-            if (grad == nullptr)
+            if (grad == nullptr && get_requires_grad())
             {
-                if (!float_dtypes.contains(dtype))
-                {
-                    throw std::runtime_error("Only arrays of floating-point types can have gradients but array " + id.str() + " has type " + dtype.str());
-                }
                 const Dtype &grad_dtype = unary_float_dtypes.at(dtype);
                 grad = is_root ? ones(get_view(), grad_dtype, device) : zeros(get_view(), grad_dtype, device);
             }
@@ -235,6 +290,10 @@ namespace xv::core
 
         void update_grad(ArrayPtr grad, bool sub = false)
         {
+            if (this->grad == nullptr)
+            {
+                return;
+            }
             this->grad = sub ? this->grad->self_sub(grad) : this->grad->self_add(grad);
             this->grad_root = this->grad;
         }
@@ -251,7 +310,7 @@ namespace xv::core
 
         const ShapeView &get_view() const { return shape.get_view(); }
 
-        const ShapeStride get_stride() const { return shape.get_stride(); }
+        const ShapeStride &get_stride() const { return shape.get_stride(); }
 
         // Gets the buffer pointer without accounting for offset
         uint8_t *get_buff_ptr() const { return buff->get_ptr(); }
@@ -267,6 +326,12 @@ namespace xv::core
 
         void set_constant() { constant = true; }
 
+        // Only floating-point arrays that are not constants can have gradients. A graph computes the gradient of an array
+        // whose flag is set and, unless it is an input, that reads an operand with a gradient.
+        bool get_requires_grad() const { return requires_grad && !constant && float_dtypes.contains(dtype); }
+
+        void set_requires_grad(bool requires_grad) { this->requires_grad = requires_grad; }
+
         std::shared_ptr<Buffer> get_buff() const { return buff; }
 
         std::shared_ptr<Op> get_op() const { return op; }
@@ -411,6 +476,10 @@ namespace xv::core
 
         static ArrayPtr from_numpy(uint8_t *ptr, usize nbytes, const Shape &shape, const Dtype &dtype = f32, const Device &device = device0, bool constant = false);
 
+        // Input without a buffer that a compiled graph binds to new data before each run. It holds data, so it does not
+        // require a gradient unless set otherwise before compiling.
+        static ArrayPtr placeholder(const ShapeView &view, const Dtype &dtype = f32, const Device &device = device0);
+
         ArrayPtr add(ArrayPtr rhs) { return binary_ss<AddOp>(rhs); }
 
         template <typename T>
@@ -613,11 +682,11 @@ namespace xv::core
 
         ArrayPtr as_contiguous() { return is_contiguous() ? shared_from_this() : identity(); }
 
-        ArrayPtr sum(const std::vector<usize> &dims = {}) { return reduce<SumOp>(dims); }
+        ArrayPtr sum(const std::vector<usize> &dims = {}, bool keepdim = true) { return reduce<SumOp>(dims, keepdim); }
 
-        ArrayPtr max(const std::vector<usize> &dims = {}) { return reduce<MaxOp>(dims); }
+        ArrayPtr max(const std::vector<usize> &dims = {}, bool keepdim = true) { return reduce<MaxOp>(dims, keepdim); }
 
-        ArrayPtr min(const std::vector<usize> &dims = {}) { return reduce<MinOp>(dims); }
+        ArrayPtr min(const std::vector<usize> &dims = {}, bool keepdim = true) { return reduce<MinOp>(dims, keepdim); }
     };
 
     inline IdGenerator Array::id_gen = IdGenerator();
@@ -53,5 +53,12 @@ namespace xv::core
         }
     };
 
+    inline const Device cpu0(DeviceType::CPU, cpu_allocator0, 0);
+
+#if __APPLE__
     inline const Device device0(DeviceType::MPS, allocator0, 0);
+#else
+    // Arrays are placed on the CPU by default when there is no GPU backend
+    inline const Device device0(DeviceType::CPU, allocator0, 0);
+#endif
 }
\ No newline at end of file
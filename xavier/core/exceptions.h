@@ -3,10 +3,10 @@
 
 namespace xv::core
 {
-    class MTLGraphNotCompiledException : public std::runtime_error
+    class GraphNotCompiledException : public std::runtime_error
     {
     public:
-        MTLGraphNotCompiledException() : std::runtime_error("Graph has not been compiled.") {}
+        GraphNotCompiledException() : std::runtime_error("Graph has not been compiled.") {}
     };
 
     class IncompatShapesForOp : public std::invalid_argument
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include "../common.h"
 
 namespace xv::core
@@ -27,21 +28,38 @@ namespace xv::core
     struct IdGenerator
     {
     private:
-        static usize counter;
+        // Each thread takes this many ids from the counter at once, so threads building graphs rarely touch it
+        static constexpr usize block_size = 1 << 10;
+        static std::atomic<usize> counter;
+
+        // Ids left to the calling thread, from next up to end
+        struct Block
+        {
+            usize next = 0;
+            usize end = 0;
+        };
+        static thread_local Block block;
 
     public:
         IdGenerator() = default;
         IdGenerator(const IdGenerator &) = delete;
         IdGenerator &operator=(const IdGenerator &) = delete;
 
+        // Unique across threads, but only increasing within one
         Id generate()
         {
-            Id curr(counter++);
+            if (block.next == block.end)
+            {
+                block.next = counter.fetch_add(block_size, std::memory_order_relaxed);
+                block.end = block.next + block_size;
+            }
+            Id curr(block.next++);
             return curr;
         }
     };
 
-    inline usize IdGenerator::counter = 1;
+    inline std::atomic<usize> IdGenerator::counter = 1;
+    inline thread_local IdGenerator::Block IdGenerator::block;
 }
 
 namespace std
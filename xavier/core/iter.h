@@ -1,18 +1,204 @@
 #pragma once
 
+#include <array>
 #include "array.h"
 
 namespace xv::core
 {
+    // Walks N arrays sharing a view one innermost row at a time, stepping the outer indices like an odometer so that only
+    // seek needs a div/mod per dimension. Size-1 dimensions are dropped and a dimension is merged into the next one when
+    // both are contiguous with each other in every array. With reorder, dimensions are sorted by decreasing stride of the
+    // first array, then the next ones, which changes the visiting order but keeps every offset.
+    template <usize N>
+    struct StridedIndexer
+    {
+    private:
+        ShapeView view;
+        std::array<ShapeStride, N> strides;
+        usize num_rows = 1;
+        // Indices of the outer dimensions and the offsets of the current row
+        ShapeView idx;
+        std::array<isize, N> offsets = {};
+
+    public:
+        StridedIndexer(const ShapeView &view, const std::array<ShapeStride, N> &strides, bool reorder = false)
+        {
+            std::vector<usize> dims;
+            for (usize d = 0; d < view.size(); d++)
+            {
+                if (view[d] == 0)
+                {
+                    dims = {d};
+                    break;
+                }
+                if (view[d] != 1)
+                {
+                    dims.push_back(d);
+                }
+            }
+            if (reorder)
+            {
+                std::stable_sort(dims.begin(), dims.end(), [&](usize lhs, usize rhs)
+                                 {
+                    for (usize i = 0; i < N; i++)
+                    {
+                        if (std::abs(strides[i][lhs]) != std::abs(strides[i][rhs]))
+                        {
+                            return std::abs(strides[i][lhs]) > std::abs(strides[i][rhs]);
+                        }
+                    }
+                    return false; });
+            }
+            for (auto d : dims)
+            {
+                bool merge = !this->view.empty();
+                for (usize i = 0; i < N && merge; i++)
+                {
+                    merge = this->strides[i].back() == strides[i][d] * static_cast<isize>(view[d]);
+                }
+                if (merge)
+                {
+                    this->view.back() *= view[d];
+                    for (usize i = 0; i < N; i++)
+                    {
+                        this->strides[i].back() = strides[i][d];
+                    }
+                }
+                else
+                {
+                    this->view.push_back(view[d]);
+                    for (usize i = 0; i < N; i++)
+                    {
+                        this->strides[i].push_back(strides[i][d]);
+                    }
+                }
+            }
+            if (this->view.empty())
+            {
+                this->view.push_back(1);
+                for (usize i = 0; i < N; i++)
+                {
+                    this->strides[i].push_back(0);
+                }
+            }
+            for (usize d = 0; d + 1 < this->view.size(); d++)
+            {
+                num_rows *= this->view[d];
+            }
+            idx.assign(this->view.size(), 0);
+        }
+
+        usize get_ndim() const { return view.size(); }
+
+        usize get_num_rows() const { return num_rows; }
+
+        usize get_numel() const { return num_rows * view.back(); }
+
+        usize get_inner_size() const { return view.back(); }
+
+        isize get_inner_stride(usize i) const { return strides[i].back(); }
+
+        isize get_offset(usize i) const { return offsets[i]; }
+
+        const std::array<isize, N> &get_offsets() const { return offsets; }
+
+        // Moves to the start of a row
+        void seek(usize row)
+        {
+            offsets.fill(0);
+            for (isize d = view.size() - 2; d >= 0; d--)
+            {
+                idx[d] = row % view[d];
+                row /= view[d];
+                for (usize i = 0; i < N; i++)
+                {
+                    offsets[i] += static_cast<isize>(idx[d]) * strides[i][d];
+                }
+            }
+        }
+
+        void next_row()
+        {
+            for (isize d = view.size() - 2; d >= 0; d--)
+            {
+                for (usize i = 0; i < N; i++)
+                {
+                    offsets[i] += strides[i][d];
+                }
+                if (++idx[d] < view[d])
+                {
+                    return;
+                }
+                for (usize i = 0; i < N; i++)
+                {
+                    offsets[i] -= static_cast<isize>(view[d]) * strides[i][d];
+                }
+                idx[d] = 0;
+            }
+        }
+
+        // Calls fn(offsets) for rows [begin, end) on a copy of the indexer, so chunks can run on different threads
+        template <class Fn>
+        void for_each_row(usize begin, usize end, Fn &&fn) const
+        {
+            StridedIndexer indexer = *this;
+            indexer.seek(begin);
+            for (usize row = begin; row < end; row++)
+            {
+                fn(indexer.offsets);
+                indexer.next_row();
+            }
+        }
+
+        // Calls fn(offsets) for elements [begin, end) in the visiting order, stepping along the innermost dimension
+        template <class Fn>
+        void for_each(usize begin, usize end, Fn &&fn) const
+        {
+            if (begin >= end)
+            {
+                return;
+            }
+            StridedIndexer indexer = *this;
+            const usize n = get_inner_size();
+            usize col = begin % n;
+            indexer.seek(begin / n);
+            std::array<isize, N> current = indexer.offsets;
+            for (usize i = 0; i < N; i++)
+            {
+                current[i] += static_cast<isize>(col) * get_inner_stride(i);
+            }
+            for (usize k = begin; k < end; k++)
+            {
+                fn(current);
+                if (++col == n)
+                {
+                    col = 0;
+                    indexer.next_row();
+                    current = indexer.offsets;
+                }
+                else
+                {
+                    for (usize i = 0; i < N; i++)
+                    {
+                        current[i] += get_inner_stride(i);
+                    }
+                }
+            }
+        }
+    };
+
     struct ArrayIter
     {
     private:
         std::shared_ptr<const Array> arr;
+        StridedIndexer<1> indexer;
         uint8_t *ptr;
         usize counter;
+        // Position in the current row
+        usize col;
 
     public:
-        ArrayIter(std::shared_ptr<const Array> arr) : arr(arr)
+        ArrayIter(std::shared_ptr<const Array> arr) : arr(arr), indexer(arr->get_view(), {arr->get_stride()})
         {
         }
 
@@ -27,12 +213,19 @@ namespace xv::core
         void start()
         {
             counter = 0;
+            col = 0;
+            indexer.seek(0);
         }
 
         uint8_t *next()
         {
-            ptr = arr->strided_idx(counter);
+            ptr = arr->get_ptr() + (indexer.get_offset(0) + static_cast<isize>(col) * indexer.get_inner_stride(0)) * arr->get_itemsize();
             counter++;
+            if (++col == indexer.get_inner_size())
+            {
+                col = 0;
+                indexer.next_row();
+            }
             return ptr;
         }
     };
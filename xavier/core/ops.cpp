@@ -25,7 +25,7 @@ namespace xv::core
 
     const std::string ReduceOp::str() const
     {
-        return get_name_str() + ", operand: " + operand->get_id().str() + ", dims: " + vnumstr(dims);
+        return get_name_str() + ", operand: " + operand->get_id().str() + ", dims: " + vnumstr(dims) + ", keepdim: " + std::to_string(keepdim);
     }
 
     void AddOp::backward(ArrayPtr arr) const
@@ -34,9 +34,7 @@ namespace xv::core
         // z = x + y
         // dx += dz
         // dy += dz
-        lhs->init_grad();
         lhs->update_grad(arr->grad);
-        rhs->init_grad();
         rhs->update_grad(arr->grad);
     }
 
@@ -45,9 +43,7 @@ namespace xv::core
         // z = x + y
         // dx += dz
         // dy -= dz
-        lhs->init_grad();
         lhs->update_grad(arr->grad);
-        rhs->init_grad();
         rhs->update_grad(arr->grad, true);
     }
 
@@ -56,9 +52,7 @@ namespace xv::core
         // z = x*y
         // dx += dz*y
         // dy += dz*x
-        lhs->init_grad();
         lhs->update_grad(arr->grad->mul(rhs));
-        rhs->init_grad();
         rhs->update_grad(arr->grad->mul(lhs));
     }
 
@@ -68,9 +62,7 @@ namespace xv::core
         // dx += dz * (1/y)
         // dy += dz * (-x / y**2)
         // dy -= dz * (z / y)
-        lhs->init_grad();
         lhs->update_grad(arr->grad->div(rhs));
-        rhs->init_grad();
         rhs->update_grad(arr->grad->mul(arr->div(rhs)), true);
     }
 
@@ -79,10 +71,8 @@ namespace xv::core
         // z = x@y
         // dx += dz @ y^T
         // dy += x^T @ dz
-        lhs->init_grad();
         // Transpose the last two dimensions of lhs and rhs
         lhs->update_grad(arr->grad->matmul(rhs->T(rhs->get_ndim() - 2)));
-        rhs->init_grad();
         rhs->update_grad(lhs->T(lhs->get_ndim() - 2)->matmul(arr->grad));
     }
 
@@ -90,7 +80,6 @@ namespace xv::core
     {
         // z = x**2
         // dx += dz * 2x
-        operand->init_grad();
         operand->update_grad(arr->grad->mul(operand->mul(2.0f)));
     }
 
@@ -99,7 +88,6 @@ namespace xv::core
         // z = sqrt(x)
         // dx += dz / (2 * sqrt(x))
         // dx += dz / 2z
-        operand->init_grad();
         operand->update_grad(arr->grad->div(arr->mul(2.0f)));
     }
 
@@ -108,7 +96,6 @@ namespace xv::core
         // z = e**x
         // dx += dz * e**x
         // dx += dz * z
-        operand->init_grad();
         operand->update_grad(arr->grad->mul(arr));
     }
 
@@ -116,7 +103,6 @@ namespace xv::core
     {
         // z = ln(x)
         // dx += dz / x
-        operand->init_grad();
         operand->update_grad(arr->grad->div(operand));
     }
 
@@ -125,7 +111,6 @@ namespace xv::core
         // z = -x
         // dx += -dz
         // dx -= dz
-        operand->init_grad();
         operand->update_grad(arr->grad, true);
     }
 
@@ -133,7 +118,6 @@ namespace xv::core
     {
         // z = x
         // dx += dz
-        operand->init_grad();
         operand->update_grad(arr->grad, false);
     }
 
@@ -143,13 +127,11 @@ namespace xv::core
         // dx += dz * -1/x**2
         // dx += dz * -z**2
         // dx -= dz * z**2
-        operand->init_grad();
         operand->update_grad(arr->grad->mul(arr->sq()), true);
     }
 
     void ReshapeOp::backward(ArrayPtr arr) const
     {
-        operand->init_grad();
         const ShapeView &view = operand->get_view();
         // Copy must be done to ensure gradient independence
         if (arr->grad->copy_when_reshape(view))
@@ -165,22 +147,62 @@ namespace xv::core
 
     void SliceOp::backward(ArrayPtr arr) const
     {
-        operand->init_grad();
+        if (operand->grad == nullptr)
+        {
+            return;
+        }
         operand->grad_root = operand->grad->slice(ranges)->self_add(arr->grad);
     }
 
     void PermuteOp::backward(ArrayPtr arr) const
     {
-        operand->init_grad();
         // Copy must be done to ensure gradient independence
         auto grad_copy = arr->grad->identity();
         auto reversed_order = grad_copy->get_shape().undo_permute_view(order);
         operand->update_grad(grad_copy->permute(reversed_order));
     }
 
+    void BroadcastOp::backward(ArrayPtr arr) const
+    {
+        // Sums the gradient over the dims the operand was repeated along, in one pass of the reduction kernel
+        const ShapeView &operand_view = operand->get_view();
+        const ShapeView &grad_view = arr->grad->get_view();
+        const usize diff = grad_view.size() - operand_view.size();
+        std::vector<usize> dims;
+        for (usize i = 0; i < grad_view.size(); i++)
+        {
+            if (i < diff || (operand_view[i - diff] == 1 && grad_view[i] != 1))
+            {
+                dims.push_back(i);
+            }
+        }
+        if (dims.empty())
+        {
+            operand->update_grad(arr->grad);
+            return;
+        }
+        // Dims added in front are dropped, after which the sum already has the view of the operand up to its 1s
+        auto grad = arr->grad->sum(dims, diff == 0);
+        if (grad->get_view() != operand_view)
+        {
+            grad = grad->reshape(operand_view);
+        }
+        operand->update_grad(grad);
+    }
+
     void SumOp::backward(ArrayPtr arr) const
     {
-        operand->init_grad();
-        operand->update_grad(arr->grad);
+        auto grad = arr->grad;
+        if (!keepdim && !dims.empty())
+        {
+            // Puts the dropped dimensions back so the gradient broadcasts over them
+            ShapeView view = operand->get_view();
+            for (auto dim : dims)
+            {
+                view[dim] = 1;
+            }
+            grad = grad->reshape(view);
+        }
+        operand->update_grad(grad);
     }
 }
\ No newline at end of file
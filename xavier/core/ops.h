@@ -12,6 +12,7 @@ namespace xv::core
         FULL,
         BUFF,
         NUMPY,
+        PLACEHOLDER,
         ADD,
         SUB,
         MUL,
@@ -58,6 +59,7 @@ namespace xv::core
         {OpName::FULL, "full"},
         {OpName::BUFF, "buff"},
         {OpName::NUMPY, "numpy"},
+        {OpName::PLACEHOLDER, "placeholder"},
         {OpName::ADD, "add"},
         {OpName::SUB, "sub"},
         {OpName::MUL, "mul"},
@@ -102,6 +104,7 @@ namespace xv::core
         OpName get_name() const { return name; }
         const std::string &get_name_str() const { return opnames.at(name); }
         OpType get_type() const { return type; }
+        // Adds the gradient of an array to the gradients of its operands, skipping operands the graph gave none
         virtual void backward(ArrayPtr arr) const {}
     };
 
@@ -172,6 +175,13 @@ namespace xv::core
         const std::string str() const override { return get_name_str(); }
     };
 
+    struct PlaceholderOp : public InitializerOp
+    {
+    public:
+        PlaceholderOp() : InitializerOp(OpName::PLACEHOLDER) {}
+        const std::string str() const override { return get_name_str(); }
+    };
+
     struct UnaryOp : public Op
     {
     protected:
@@ -216,11 +226,13 @@ namespace xv::core
     protected:
         ArrayPtr operand;
         std::vector<usize> dims;
+        bool keepdim;
 
     public:
-        ReduceOp(OpName name, ArrayPtr operand, const std::vector<usize> &dims) : Op(name, OpType::REDUCE), operand(operand), dims(dims) {}
+        ReduceOp(OpName name, ArrayPtr operand, const std::vector<usize> &dims, bool keepdim) : Op(name, OpType::REDUCE), operand(operand), dims(dims), keepdim(keepdim) {}
         ArrayPtr get_operand() const { return operand; }
         const std::vector<usize> &get_dims() { return dims; }
+        bool get_keepdim() const { return keepdim; }
         const std::string str() const override;
     };
 
@@ -408,24 +420,25 @@ namespace xv::core
         {
             return TransformOp::str() + ", view: (" + vnumstr(view) + ")";
         }
+        void backward(ArrayPtr arr) const override;
     };
 
     struct SumOp : public ReduceOp
     {
     public:
-        SumOp(ArrayPtr operand, const std::vector<usize> &dims) : ReduceOp(OpName::SUM, operand, dims) {}
+        SumOp(ArrayPtr operand, const std::vector<usize> &dims, bool keepdim) : ReduceOp(OpName::SUM, operand, dims, keepdim) {}
         void backward(ArrayPtr arr) const override;
     };
 
     struct MaxOp : public ReduceOp
     {
     public:
-        MaxOp(ArrayPtr operand, const std::vector<usize> &dims) : ReduceOp(OpName::MAX, operand, dims) {}
+        MaxOp(ArrayPtr operand, const std::vector<usize> &dims, bool keepdim) : ReduceOp(OpName::MAX, operand, dims, keepdim) {}
     };
 
     struct MinOp : public ReduceOp
     {
     public:
-        MinOp(ArrayPtr operand, const std::vector<usize> &dims) : ReduceOp(OpName::MIN, operand, dims) {}
+        MinOp(ArrayPtr operand, const std::vector<usize> &dims, bool keepdim) : ReduceOp(OpName::MIN, operand, dims, keepdim) {}
     };
 }
\ No newline at end of file
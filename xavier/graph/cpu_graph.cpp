@@ -0,0 +1,278 @@
+#include "cpu_graph.h"
+
+namespace xv::graph
+{
+    namespace cpu = backend::cpu;
+
+    void CPUGraph::call_initializer(ArrayPtr arr)
+    {
+        arr->alloc();
+        auto op = get_op(arr);
+        switch (op->get_name())
+        {
+        case OpName::FULL:
+        {
+            auto full_op = std::static_pointer_cast<FullOp>(op);
+            cpu::full(arr, full_op->get_const(), arr->get_dtype().get_size(), ctx);
+            break;
+        }
+        case OpName::ARANGE:
+        {
+            auto arange_op = std::static_pointer_cast<ArangeOp>(op);
+            cpu::arange(arr, arange_op->get_start(), arange_op->get_step(), ctx);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void CPUGraph::call_unary(ArrayPtr arr)
+    {
+        auto unary_op = std::static_pointer_cast<UnaryOp>(get_op(arr));
+        auto operand = unary_op->get_operand();
+        if (unary_op->is_in_place())
+        {
+            arr->alloc(*operand->get_buff());
+        }
+        else
+        {
+            arr->alloc();
+        }
+        cpu::unary_ss(unary_op->get_name_str(), operand, arr, ctx);
+    }
+
+    void CPUGraph::call_binary(ArrayPtr arr)
+    {
+        auto binary_op = std::static_pointer_cast<BinaryOp>(get_op(arr));
+        auto lhs = binary_op->get_lhs();
+        auto rhs = binary_op->get_rhs();
+        if (binary_op->is_in_place())
+        {
+            // Share memory with lhs
+            arr->alloc(*lhs->get_buff());
+        }
+        else
+        {
+            arr->alloc();
+        }
+        auto immediate = immediates.find(arr->get_id());
+        cpu::binary_ss(binary_op->get_name_str(), lhs, rhs, arr, ctx, immediate != immediates.end() ? immediate->second : std::vector<isize>{});
+    }
+
+    void CPUGraph::call_matmul(ArrayPtr arr)
+    {
+        auto matmul_op = std::static_pointer_cast<MatmulOp>(get_op(arr));
+        auto lhs = matmul_op->get_lhs();
+        auto rhs = matmul_op->get_rhs();
+        arr->alloc();
+        cpu::matmul(lhs, rhs, arr, ctx);
+    }
+
+    void CPUGraph::call_transform(ArrayPtr arr)
+    {
+        auto op = get_op(arr);
+        switch (op->get_name())
+        {
+        case OpName::RESHAPE:
+        {
+            auto reshape_op = std::static_pointer_cast<ReshapeOp>(op);
+            auto operand = reshape_op->get_operand();
+            if (!operand->copy_when_reshape(reshape_op->get_view()))
+            {
+                arr->alloc(*operand->get_buff());
+            }
+            else
+            {
+                arr->alloc();
+                // Same as copy
+                cpu::unary_ss("identity", operand, arr, ctx);
+            }
+            break;
+        }
+        case OpName::SLICE:
+        {
+            auto slice_op = std::static_pointer_cast<SliceOp>(op);
+            auto operand = slice_op->get_operand();
+            arr->alloc(*operand->get_buff());
+            break;
+        }
+        case OpName::BROADCAST:
+        {
+            auto broadcast_op = std::static_pointer_cast<BroadcastOp>(op);
+            auto operand = broadcast_op->get_operand();
+            arr->alloc(*operand->get_buff());
+            break;
+        }
+        case OpName::PERMUTE:
+        {
+            auto permute_op = std::static_pointer_cast<PermuteOp>(op);
+            auto operand = permute_op->get_operand();
+            arr->alloc(*operand->get_buff());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    void CPUGraph::call_reduce(ArrayPtr arr)
+    {
+        auto op = get_op(arr);
+        auto reduce_op = std::static_pointer_cast<ReduceOp>(op);
+        auto operand = reduce_op->get_operand();
+        arr->alloc();
+        auto &dims = reduce_op->get_dims();
+        if (dims.size() == 0 || dims.size() == operand->get_ndim())
+        {
+            // Reduce to one item
+            cpu::reduce_all(reduce_op->get_name_str(), operand, arr, ctx);
+        }
+        else
+        {
+            // Reduce multiple dimensions
+            cpu::reduce_dims(reduce_op->get_name_str(), operand, arr, dims, ctx);
+        }
+    }
+
+    bool CPUGraph::can_inline(ArrayPtr arr)
+    {
+        return std::static_pointer_cast<BinaryOp>(get_op(arr))->get_lhs()->get_dtype() == f32;
+    }
+
+    bool CPUGraph::can_fuse(ArrayPtr arr)
+    {
+        // The fused kernel runs on floats only, where every elementwise op keeps the dtype
+        for (auto &operand : get_operands(arr))
+        {
+            if (operand->get_dtype() != f32)
+            {
+                return false;
+            }
+        }
+        return arr->get_dtype() == f32;
+    }
+
+    void CPUGraph::call_fused(ArrayPtr arr, const Fusion &fusion)
+    {
+        static_assert(max_fusion_inputs <= cpu::max_fused_inputs);
+        auto alias = get_alias(arr);
+        if (alias != nullptr)
+        {
+            arr->alloc(*alias->get_buff());
+        }
+        else
+        {
+            arr->alloc();
+        }
+        cpu::fused(fusion.inputs, arr, fusion.code, ctx);
+    }
+
+    void CPUGraph::execute(const std::vector<ArrayPtr> &order, const Schedule &schedule, const std::function<void(usize)> &step)
+    {
+        // Holding the pool keeps it alive for the whole run if the number of workers changes meanwhile
+        auto pool = cpu::get_thread_pool();
+        if (pool->get_num_workers() == 1 || schedule.num_deps.size() != order.size())
+        {
+            Graph::execute(order, schedule, step);
+            return;
+        }
+        struct Run
+        {
+            const Schedule &schedule;
+            const std::function<void(usize)> &step;
+            cpu::ThreadPool &pool;
+            std::unique_ptr<std::atomic<usize>[]> num_deps;
+            std::atomic<usize> remaining;
+            std::atomic<bool> failed = false;
+            std::exception_ptr error = nullptr;
+
+            void run(usize i)
+            {
+                while (true)
+                {
+                    // After a failure the remaining arrays are only counted down
+                    if (!failed.load(std::memory_order_acquire))
+                    {
+                        try
+                        {
+                            step(i);
+                        }
+                        catch (...)
+                        {
+                            if (!failed.exchange(true))
+                            {
+                                error = std::current_exception();
+                            }
+                        }
+                    }
+                    // Continues with the first array made ready here and hands the others to the pool
+                    usize next = i;
+                    for (auto successor : schedule.successors[i])
+                    {
+                        if (num_deps[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        {
+                            if (next == i)
+                            {
+                                next = successor;
+                            }
+                            else
+                            {
+                                pool.submit(new cpu::Task([this, successor]()
+                                                          { run(successor); }));
+                            }
+                        }
+                    }
+                    remaining.fetch_sub(1, std::memory_order_acq_rel);
+                    if (next == i)
+                    {
+                        return;
+                    }
+                    i = next;
+                }
+            }
+        };
+        Run run{schedule, step, *pool, std::make_unique<std::atomic<usize>[]>(order.size()), order.size()};
+        std::vector<usize> ready;
+        for (usize i = 0; i < order.size(); i++)
+        {
+            run.num_deps[i].store(schedule.num_deps[i], std::memory_order_relaxed);
+            if (schedule.num_deps[i] == 0)
+            {
+                ready.push_back(i);
+            }
+        }
+        for (usize i = 1; i < ready.size(); i++)
+        {
+            pool->submit(new cpu::Task([&run, idx = ready[i]]()
+                                      { run.run(idx); }));
+        }
+        if (!ready.empty())
+        {
+            run.run(ready.front());
+        }
+        while (run.remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (!pool->run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+        if (run.error != nullptr)
+        {
+            std::rethrow_exception(run.error);
+        }
+    }
+
+    void CPUGraph::launch(std::function<void()> run)
+    {
+        auto pool = cpu::get_thread_pool();
+        // A pool with a single worker runs tasks on the submitting thread, which would wait for the run
+        if (pool->get_num_workers() == 1)
+        {
+            Graph::launch(std::move(run));
+            return;
+        }
+        pool->submit(new cpu::Task(std::move(run)));
+    }
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../backend/cpu/cpu_initializers.h"
+#include "../backend/cpu/cpu_unary.h"
+#include "../backend/cpu/cpu_binary.h"
+#include "../backend/cpu/cpu_matmul.h"
+#include "../backend/cpu/cpu_reduce.h"
+#include "../backend/cpu/cpu_fused.h"
+#include "../backend/cpu/thread_pool.h"
+#include "graph.h"
+
+namespace xv::graph
+{
+    class CPUGraph : public Graph
+    {
+    private:
+        std::shared_ptr<backend::cpu::CPUContext> ctx;
+
+    protected:
+        void call_initializer(ArrayPtr arr) override;
+
+        void call_unary(ArrayPtr arr) override;
+
+        void call_binary(ArrayPtr arr) override;
+
+        void call_matmul(ArrayPtr arr) override;
+
+        void call_transform(ArrayPtr arr) override;
+
+        void call_reduce(ArrayPtr arr) override;
+
+        bool can_inline(ArrayPtr arr) override;
+
+        bool can_fuse(ArrayPtr arr) override;
+
+        void call_fused(ArrayPtr arr, const Fusion &fusion) override;
+
+        bool can_schedule() override { return true; }
+
+        // Runs arrays as their dependencies complete on the worker pool that also splits each kernel, so wide graphs
+        // spread over the workers while narrow ones split their kernels
+        void execute(const std::vector<ArrayPtr> &order, const Schedule &schedule, const std::function<void(usize)> &step) override;
+
+        // Runs started without waiting go to the same pool, so they never block a worker and share it with the kernels
+        void launch(std::function<void()> run) override;
+
+    public:
+        CPUGraph(ArrayPtr root, std::shared_ptr<backend::cpu::CPUContext> ctx) : Graph(root), ctx(ctx) {}
+
+        // A run started without waiting calls the kernels of this class
+        ~CPUGraph() override { wait(); }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,2105 @@
+#include <typeinfo>
+#include <thread>
+#include <map>
+#include <set>
+#include <queue>
+#include <utility>
+#include "plan_cache.h"
+
+namespace xv::graph
+{
+    namespace
+    {
+        // Operations mapping each output element to the elements at the same index of their operands
+        bool is_elementwise(const std::shared_ptr<Op> &op)
+        {
+            switch (op->get_name())
+            {
+            case OpName::ADD:
+            case OpName::SUB:
+            case OpName::MUL:
+            case OpName::DIV:
+            case OpName::SQ:
+            case OpName::SQRT:
+            case OpName::NEG:
+            case OpName::IDENTITY:
+            case OpName::EXP:
+            case OpName::LOG:
+            case OpName::RECIP:
+                return true;
+            default:
+                return false;
+            }
+        }
+
+        // Value of an elementwise op over single values, matching the CPU functors
+        float apply_scalar(OpName name, float lhs, float rhs)
+        {
+            switch (name)
+            {
+            case OpName::ADD:
+                return lhs + rhs;
+            case OpName::SUB:
+                return lhs - rhs;
+            case OpName::MUL:
+                return lhs * rhs;
+            case OpName::DIV:
+                return lhs / rhs;
+            case OpName::SQ:
+                return lhs * lhs;
+            case OpName::SQRT:
+                return std::sqrt(lhs);
+            case OpName::NEG:
+                return -lhs;
+            case OpName::EXP:
+                return std::exp(lhs);
+            case OpName::LOG:
+                return std::log(lhs);
+            case OpName::RECIP:
+                return 1.0f / lhs;
+            default:
+                return lhs;
+            }
+        }
+
+        bool is_in_place(const std::shared_ptr<Op> &op)
+        {
+            switch (op->get_type())
+            {
+            case OpType::UNARY:
+                return std::static_pointer_cast<UnaryOp>(op)->is_in_place();
+            case OpType::BINARY:
+                return std::static_pointer_cast<BinaryOp>(op)->is_in_place();
+            default:
+                return false;
+            }
+        }
+
+        // Whether an in-place array at a position in (begin, end) writes to the storage
+        bool is_written(const std::unordered_map<Id, std::vector<usize>> &writes, Id storage, usize begin, usize end)
+        {
+            auto iter = writes.find(storage);
+            if (iter == writes.end())
+            {
+                return false;
+            }
+            auto next = std::upper_bound(iter->second.begin(), iter->second.end(), begin);
+            return next != iter->second.end() && *next < end;
+        }
+
+        // Whether two arrays read the same elements from the same memory layout
+        bool same_layout(ArrayPtr lhs, ArrayPtr rhs)
+        {
+            return lhs->get_dtype() == rhs->get_dtype() && lhs->get_device() == rhs->get_device() && lhs->get_offset() == rhs->get_offset() &&
+                   lhs->get_view() == rhs->get_view() && lhs->get_stride() == rhs->get_stride();
+        }
+
+        // Op, layout and attributes of an array, which with its operands determine what its kernel computes
+        std::string get_signature(ArrayPtr arr, const std::shared_ptr<Op> &op)
+        {
+            auto &shape = arr->get_shape();
+            std::string signature = op->get_name_str() + "|" + std::to_string(is_in_place(op)) + "|" + arr->get_dtype().str() + "|" + arr->get_device().str() + "|" +
+                                    std::to_string(shape.get_offset()) + "|" + vnumstr(shape.get_view()) + "|" + vnumstr(shape.get_stride());
+            if (op->get_name() == OpName::FULL)
+            {
+                signature += "|" + std::to_string(std::static_pointer_cast<FullOp>(op)->get_const());
+            }
+            else if (op->get_name() == OpName::ARANGE)
+            {
+                auto arange_op = std::static_pointer_cast<ArangeOp>(op);
+                signature += "|" + std::to_string(arange_op->get_start()) + "|" + std::to_string(arange_op->get_step());
+            }
+            else if (op->get_type() == OpType::REDUCE)
+            {
+                auto reduce_op = std::static_pointer_cast<ReduceOp>(op);
+                signature += "|" + vnumstr(reduce_op->get_dims()) + "|" + std::to_string(reduce_op->get_keepdim());
+            }
+            return signature;
+        }
+
+        // Run of a graph, reporting to its future, and the runs started after it that wait for it
+        struct Run
+        {
+            std::promise<void> done;
+            std::shared_future<void> future = done.get_future().share();
+            // Guarded by the lock of Runs
+            bool finished = false;
+            usize num_deps = 0;
+            std::vector<std::shared_ptr<Run>> successors;
+            // Set for runs started without waiting, which the last run they wait for starts
+            std::function<void()> launch;
+        };
+
+        // Unfinished runs of graphs and the last one using each array
+        struct Runs
+        {
+            std::mutex mutex;
+            std::unordered_map<Id, std::shared_ptr<Run>> last;
+
+            // Records a run using the arrays after the unfinished runs started before that use any of them, each once, and
+            // returns their futures. Finished runs are dropped first.
+            std::vector<std::shared_future<void>> add(const std::vector<Id> &ids, std::shared_ptr<Run> run)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::erase_if(last, [](auto &entry)
+                              { return entry.second->finished; });
+                std::unordered_set<Run *> found;
+                std::vector<std::shared_future<void>> deps;
+                for (auto &id : ids)
+                {
+                    auto &entry = last[id];
+                    if (entry != nullptr && entry != run && found.insert(entry.get()).second)
+                    {
+                        entry->successors.push_back(run);
+                        deps.push_back(entry->future);
+                    }
+                    entry = run;
+                }
+                run->num_deps = deps.size();
+                return deps;
+            }
+
+            // Marks a run finished and returns the runs started without waiting that no longer wait for any other
+            std::vector<std::shared_ptr<Run>> finish(Run &run)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                run.finished = true;
+                std::vector<std::shared_ptr<Run>> ready;
+                for (auto &successor : run.successors)
+                {
+                    if (--successor->num_deps == 0 && successor->launch != nullptr)
+                    {
+                        ready.push_back(successor);
+                    }
+                }
+                run.successors.clear();
+                return ready;
+            }
+        };
+
+        // Compiling sets the gradients of arrays that other graphs may share
+        std::mutex compile_mutex;
+
+        Runs &get_runs()
+        {
+            static Runs runs;
+            return runs;
+        }
+    }
+
+    bool Graph::reach(ArrayPtr arr)
+    {
+        // Another graph may have given the array the same index, so the index only counts if it leads back to the array
+        if (arr->index < nodes.size() && nodes[arr->index] == arr)
+        {
+            return false;
+        }
+        arr->index = nodes.size();
+        nodes.push_back(std::move(arr));
+        return true;
+    }
+
+    usize Graph::get_index(ArrayPtr arr) const
+    {
+        if (arr->index >= nodes.size() || nodes[arr->index] != arr)
+        {
+            throw std::invalid_argument("Array " + arr->get_id().str() + " is not in the graph.");
+        }
+        return arr->index;
+    }
+
+    void Graph::toposort(ArrayPtr arr, std::vector<ArrayPtr> &order)
+    {
+        // Arrays on the path from the first one, each with the start of its operands on the operand stack and the next one
+        // to visit. The operands of the top frame run to the end of the stack.
+        struct Frame
+        {
+            ArrayPtr arr;
+            usize begin;
+            usize next;
+        };
+        if (!reach(arr))
+        {
+            return;
+        }
+        std::vector<ArrayPtr> operands;
+        std::vector<Frame> stack;
+        stack.push_back({arr, 0, 0});
+        append_op_operands(arr, operands);
+        while (!stack.empty())
+        {
+            auto &frame = stack.back();
+            if (frame.next == operands.size())
+            {
+                // Every operand is ordered
+                operands.resize(frame.begin);
+                order.push_back(std::move(frame.arr));
+                stack.pop_back();
+                continue;
+            }
+            auto operand = operands[frame.next++];
+            if (reach(operand))
+            {
+                stack.push_back({operand, operands.size(), operands.size()});
+                append_op_operands(operand, operands);
+            }
+        }
+    }
+
+    std::vector<ArrayPtr> Graph::get_operands(ArrayPtr arr) const
+    {
+        auto duplicate = duplicates.find(arr->get_id());
+        if (duplicate != duplicates.end())
+        {
+            return {duplicate->second};
+        }
+        auto fusion = fusions.find(arr->get_id());
+        if (fusion != fusions.end())
+        {
+            return fusion->second.inputs;
+        }
+        auto operands = get_op_operands(arr);
+        auto immediate = immediates.find(arr->get_id());
+        if (immediate != immediates.end())
+        {
+            operands.erase(operands.begin() + immediate->second[0]);
+        }
+        return operands;
+    }
+
+    std::shared_ptr<Op> Graph::get_op(ArrayPtr arr) const
+    {
+        auto op = ops.find(arr->get_id());
+        return op != ops.end() ? op->second : arr->get_op();
+    }
+
+    std::vector<ArrayPtr> Graph::get_op_operands(ArrayPtr arr) const
+    {
+        std::vector<ArrayPtr> operands;
+        append_op_operands(arr, operands);
+        return operands;
+    }
+
+    void Graph::append_op_operands(ArrayPtr arr, std::vector<ArrayPtr> &operands) const
+    {
+        auto op = get_op(arr);
+        switch (op->get_type())
+        {
+        case OpType::INITIALIZER:
+            break;
+        case OpType::UNARY:
+            operands.push_back(std::static_pointer_cast<UnaryOp>(op)->get_operand());
+            break;
+        case OpType::BINARY:
+        {
+            auto binary_op = std::static_pointer_cast<BinaryOp>(op);
+            operands.push_back(binary_op->get_lhs());
+            operands.push_back(binary_op->get_rhs());
+            break;
+        }
+        case OpType::MATMUL:
+        {
+            auto matmul_op = std::static_pointer_cast<MatmulOp>(op);
+            operands.push_back(matmul_op->get_lhs());
+            operands.push_back(matmul_op->get_rhs());
+            break;
+        }
+        case OpType::TRANSFORM:
+            operands.push_back(std::static_pointer_cast<TransformOp>(op)->get_operand());
+            break;
+        default:
+            operands.push_back(std::static_pointer_cast<ReduceOp>(op)->get_operand());
+        }
+    }
+
+    ArrayPtr Graph::get_alias(ArrayPtr arr) const
+    {
+        auto duplicate = duplicates.find(arr->get_id());
+        if (duplicate != duplicates.end())
+        {
+            return duplicate->second;
+        }
+        auto op = get_op(arr);
+        switch (op->get_type())
+        {
+        case OpType::UNARY:
+        {
+            auto unary_op = std::static_pointer_cast<UnaryOp>(op);
+            return unary_op->is_in_place() ? unary_op->get_operand() : nullptr;
+        }
+        case OpType::BINARY:
+        {
+            auto binary_op = std::static_pointer_cast<BinaryOp>(op);
+            return binary_op->is_in_place() ? binary_op->get_lhs() : nullptr;
+        }
+        case OpType::TRANSFORM:
+        {
+            auto operand = std::static_pointer_cast<TransformOp>(op)->get_operand();
+            if (op->get_name() == OpName::RESHAPE && operand->copy_when_reshape(std::static_pointer_cast<ReshapeOp>(op)->get_view()))
+            {
+                return nullptr;
+            }
+            return operand;
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    Id Graph::get_storage(ArrayPtr arr) const
+    {
+        std::vector<Id> path;
+        Id storage = arr->get_id();
+        while (true)
+        {
+            auto found = storages.find(arr->get_id());
+            if (found != storages.end() && found->second.second == alias_version)
+            {
+                storage = found->second.first;
+                break;
+            }
+            path.push_back(arr->get_id());
+            auto alias = get_alias(arr);
+            if (alias == nullptr)
+            {
+                storage = arr->get_id();
+                break;
+            }
+            arr = alias;
+        }
+        for (auto &id : path)
+        {
+            storages[id] = {storage, alias_version};
+        }
+        return storage;
+    }
+
+    std::unordered_map<Id, std::vector<usize>> Graph::get_writes(const std::vector<ArrayPtr> &order) const
+    {
+        std::unordered_map<Id, std::vector<usize>> writes;
+        for (usize i = 0; i < order.size(); i++)
+        {
+            if (is_in_place(get_op(order[i])))
+            {
+                writes[get_storage(order[i])].push_back(i);
+            }
+        }
+        return writes;
+    }
+
+    void Graph::merge_duplicates()
+    {
+        std::vector<ArrayPtr> order = fw_order;
+        order.insert(order.end(), bw_order.begin(), bw_order.end());
+        std::unordered_map<Id, usize> position;
+        position.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            position[order[i]->get_id()] = i;
+        }
+        auto writes = get_writes(order);
+        std::unordered_map<std::string, ArrayPtr> canonical;
+        canonical.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            auto &arr = order[i];
+            auto op = get_op(arr);
+            auto name = op->get_name();
+            // Loaded data and writes are never merged
+            if (is_in_place(op) || name == OpName::RANDN || name == OpName::BUFF || name == OpName::NUMPY || name == OpName::PLACEHOLDER)
+            {
+                continue;
+            }
+            std::string key = get_signature(arr, op);
+            auto operands = get_operands(arr);
+            for (auto &operand : operands)
+            {
+                auto duplicate = duplicates.find(operand->get_id());
+                key += "|" + (duplicate != duplicates.end() ? duplicate->second : operand)->get_id().str();
+            }
+            auto iter = canonical.find(key);
+            if (iter == canonical.end())
+            {
+                canonical[key] = arr;
+                continue;
+            }
+            // The earlier array must keep its value while the later one is read through it, and the operands must not
+            // change in between
+            auto &first = iter->second;
+            usize first_pos = position.at(first->get_id());
+            bool mergeable = !is_written(writes, get_storage(first), first_pos, order.size()) &&
+                             !is_written(writes, get_storage(arr), i, order.size());
+            for (auto &operand : operands)
+            {
+                mergeable = mergeable && !is_written(writes, get_storage(operand), first_pos, i);
+            }
+            if (mergeable)
+            {
+                duplicates[arr->get_id()] = first;
+                alias_version++;
+            }
+            else
+            {
+                first = arr;
+            }
+        }
+        num_merged = duplicates.size();
+    }
+
+    void Graph::fold_constants()
+    {
+        std::vector<ArrayPtr> order = fw_order;
+        order.insert(order.end(), bw_order.begin(), bw_order.end());
+        // Buffers written by in-place arrays, such as gradient accumulators, never hold constants
+        std::unordered_set<Id> written;
+        for (auto &arr : order)
+        {
+            if (is_in_place(get_op(arr)))
+            {
+                written.insert(get_storage(arr));
+            }
+        }
+        for (auto &arr : order)
+        {
+            auto op = get_op(arr);
+            auto name = op->get_name();
+            auto operands = get_op_operands(arr);
+            if (written.contains(get_storage(arr)))
+            {
+                continue;
+            }
+            if (op->get_type() == OpType::INITIALIZER ? name != OpName::FULL && name != OpName::ARANGE
+                                                      : !std::ranges::all_of(operands, [&](ArrayPtr operand)
+                                                                             { return constants.contains(operand->get_id()); }))
+            {
+                continue;
+            }
+            constants.insert(arr->get_id());
+            if (arr->get_dtype() != f32 || !std::ranges::all_of(operands, [&](ArrayPtr operand)
+                                                                { return scalars.contains(operand->get_id()); }))
+            {
+                continue;
+            }
+            if (name == OpName::FULL)
+            {
+                scalars[arr->get_id()] = std::bit_cast<float>(std::static_pointer_cast<FullOp>(op)->get_const());
+            }
+            else if (op->get_type() == OpType::TRANSFORM)
+            {
+                scalars[arr->get_id()] = scalars.at(operands[0]->get_id());
+            }
+            else if (is_elementwise(op))
+            {
+                float lhs = scalars.at(operands[0]->get_id());
+                float rhs = operands.size() > 1 ? scalars.at(operands[1]->get_id()) : lhs;
+                scalars[arr->get_id()] = apply_scalar(name, lhs, rhs);
+            }
+        }
+        // Binary arrays take a single-valued operand as an immediate, preferably the right one
+        for (auto &arr : order)
+        {
+            if (get_op(arr)->get_type() != OpType::BINARY || duplicates.contains(arr->get_id()) || !can_inline(arr))
+            {
+                continue;
+            }
+            auto operands = get_op_operands(arr);
+            for (isize i = 1; i >= 0; i--)
+            {
+                auto scalar = scalars.find(operands[i]->get_id());
+                // The left operand of an in-place array is the buffer it writes to
+                if (scalar != scalars.end() && !(i == 0 && is_in_place(get_op(arr))))
+                {
+                    immediates[arr->get_id()] = {i, std::bit_cast<int32_t>(scalar->second)};
+                    break;
+                }
+            }
+        }
+    }
+
+    void Graph::rewrite_algebraic(const std::unordered_set<Id> &kept)
+    {
+        std::vector<ArrayPtr> order = fw_order;
+        order.insert(order.end(), bw_order.begin(), bw_order.end());
+        std::unordered_map<Id, usize> position;
+        std::unordered_map<Id, usize> num_readers;
+        position.reserve(order.size());
+        num_readers.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            position[order[i]->get_id()] = i;
+            for (auto &operand : get_operands(order[i]))
+            {
+                num_readers[operand->get_id()]++;
+            }
+        }
+        auto writes = get_writes(order);
+        std::unordered_set<Id> removed;
+        auto is_scalar = [&](ArrayPtr arr, float value)
+        {
+            auto scalar = scalars.find(arr->get_id());
+            return scalar != scalars.end() && scalar->second == value;
+        };
+        auto is_op = [this](ArrayPtr arr, OpName name)
+        {
+            auto op = get_op(arr);
+            return op->get_name() == name && !is_in_place(op);
+        };
+
+        // Each rule returns an earlier array holding the same values as the array, or nullptr
+        using Equivalence = std::function<ArrayPtr(ArrayPtr, const std::vector<ArrayPtr> &)>;
+        std::vector<Equivalence> equivalences = {
+            // identity(x) = x
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &operands) -> ArrayPtr
+            {
+                return get_op(arr)->get_name() == OpName::IDENTITY ? operands[0] : nullptr;
+            },
+            // neg(neg(x)) = x
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &operands) -> ArrayPtr
+            {
+                return get_op(arr)->get_name() == OpName::NEG && is_op(operands[0], OpName::NEG) ? get_op_operands(operands[0])[0] : nullptr;
+            },
+            // x * 1 = 1 * x = x / 1 = x + 0 = 0 + x = x - 0 = x
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &operands) -> ArrayPtr
+            {
+                switch (get_op(arr)->get_name())
+                {
+                case OpName::MUL:
+                    return is_scalar(operands[1], 1.0f) ? operands[0] : is_scalar(operands[0], 1.0f) ? operands[1] : nullptr;
+                case OpName::ADD:
+                    return is_scalar(operands[1], 0.0f) ? operands[0] : is_scalar(operands[0], 0.0f) ? operands[1] : nullptr;
+                case OpName::DIV:
+                    return is_scalar(operands[1], 1.0f) ? operands[0] : nullptr;
+                case OpName::SUB:
+                    return is_scalar(operands[1], 0.0f) ? operands[0] : nullptr;
+                default:
+                    return nullptr;
+                }
+            },
+            // Views of views that end up with the layout of an earlier view, such as a permutation and its inverse
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &) -> ArrayPtr
+            {
+                for (auto view = arr; get_op(view)->get_type() == OpType::TRANSFORM && get_alias(view) != nullptr;)
+                {
+                    // Earlier rewrites may have made the operand a duplicate, whose source is what stays computed
+                    view = get_op_operands(view)[0];
+                    auto duplicate = duplicates.find(view->get_id());
+                    if (duplicate != duplicates.end())
+                    {
+                        view = duplicate->second;
+                    }
+                    if (removed.contains(view->get_id()))
+                    {
+                        return nullptr;
+                    }
+                    if (same_layout(view, arr))
+                    {
+                        return view;
+                    }
+                }
+                return nullptr;
+            }};
+
+        // Each rule returns an op over the operands of an operand, the bypassed operand, or nullptr
+        using Replacement = std::function<std::pair<std::shared_ptr<Op>, ArrayPtr>(ArrayPtr, const std::vector<ArrayPtr> &)>;
+        std::vector<Replacement> replacements = {
+            // x * recip(y) = recip(y) * x = x / y
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &operands) -> std::pair<std::shared_ptr<Op>, ArrayPtr>
+            {
+                if (get_op(arr)->get_name() != OpName::MUL)
+                {
+                    return {nullptr, nullptr};
+                }
+                if (is_op(operands[1], OpName::RECIP))
+                {
+                    return {std::make_shared<DivOp>(operands[0], get_op_operands(operands[1])[0], is_in_place(get_op(arr))), operands[1]};
+                }
+                if (is_op(operands[0], OpName::RECIP) && !is_in_place(get_op(arr)))
+                {
+                    return {std::make_shared<DivOp>(operands[1], get_op_operands(operands[0])[0], false), operands[0]};
+                }
+                return {nullptr, nullptr};
+            },
+            // x + neg(y) = neg(y) + x = x - y and x - neg(y) = x + y
+            [&](ArrayPtr arr, const std::vector<ArrayPtr> &operands) -> std::pair<std::shared_ptr<Op>, ArrayPtr>
+            {
+                auto name = get_op(arr)->get_name();
+                if (name == OpName::ADD && is_op(operands[1], OpName::NEG))
+                {
+                    return {std::make_shared<SubOp>(operands[0], get_op_operands(operands[1])[0], is_in_place(get_op(arr))), operands[1]};
+                }
+                if (name == OpName::ADD && is_op(operands[0], OpName::NEG) && !is_in_place(get_op(arr)))
+                {
+                    return {std::make_shared<SubOp>(operands[1], get_op_operands(operands[0])[0], false), operands[0]};
+                }
+                if (name == OpName::SUB && is_op(operands[1], OpName::NEG))
+                {
+                    return {std::make_shared<AddOp>(operands[0], get_op_operands(operands[1])[0], is_in_place(get_op(arr))), operands[1]};
+                }
+                return {nullptr, nullptr};
+            }};
+
+        // Arrays that no kernel reads any more stop being computed, along with the operands only they read. Duplicates
+        // have no kernel and are not counted again.
+        auto remove = [&](auto &&remove, ArrayPtr arr) -> void
+        {
+            if (removed.contains(arr->get_id()) || duplicates.contains(arr->get_id()))
+            {
+                return;
+            }
+            removed.insert(arr->get_id());
+            num_simplified++;
+            simplified_nbytes += get_alias(arr) == nullptr ? arr->get_nbytes() : 0;
+            for (auto &operand : get_operands(arr))
+            {
+                auto id = operand->get_id();
+                if (--num_readers[id] == 0 && !kept.contains(id) && !constants.contains(id) && !is_in_place(get_op(operand)) &&
+                    get_op(operand)->get_type() != OpType::INITIALIZER)
+                {
+                    remove(remove, operand);
+                }
+            }
+        };
+        for (usize i = 0; i < order.size(); i++)
+        {
+            auto &arr = order[i];
+            auto id = arr->get_id();
+            if (removed.contains(id) || duplicates.contains(id) || constants.contains(id) || arr->get_buff() != nullptr ||
+                get_op(arr)->get_type() == OpType::INITIALIZER)
+            {
+                continue;
+            }
+            auto operands = get_op_operands(arr);
+            bool rewritten = false;
+            for (usize j = 0; j < equivalences.size() && !rewritten && !is_in_place(get_op(arr)); j++)
+            {
+                auto src = equivalences[j](arr, operands);
+                if (src == nullptr)
+                {
+                    continue;
+                }
+                auto duplicate = duplicates.find(src->get_id());
+                if (duplicate != duplicates.end())
+                {
+                    src = duplicate->second;
+                }
+                if (removed.contains(src->get_id()))
+                {
+                    continue;
+                }
+                // Unless both already share memory, the array now reads the buffer of the earlier one, which must then
+                // keep its values until the end
+                bool shared = get_storage(src) == get_storage(arr);
+                if (!same_layout(src, arr) ||
+                    (!shared && (is_written(writes, get_storage(src), position.at(src->get_id()), order.size()) ||
+                                 is_written(writes, get_storage(arr), i, order.size()))))
+                {
+                    continue;
+                }
+                // The kernel of the array is removed but the array stays in the order as a view of the earlier one
+                num_readers[src->get_id()]++;
+                remove(remove, arr);
+                removed.erase(id);
+                duplicates[id] = src;
+                alias_version++;
+                immediates.erase(id);
+                rewritten = true;
+            }
+            for (usize j = 0; j < replacements.size() && !rewritten; j++)
+            {
+                auto [op, bypassed] = replacements[j](arr, operands);
+                if (op == nullptr)
+                {
+                    continue;
+                }
+                // The bypassed operand must be read by this array only and its own operand must not change in between
+                auto operand = get_op_operands(bypassed)[0];
+                auto bypassed_id = bypassed->get_id();
+                if (num_readers[bypassed_id] != 1 || kept.contains(bypassed_id) || constants.contains(bypassed_id) ||
+                    duplicates.contains(bypassed_id) || bypassed->get_dtype() != operand->get_dtype() ||
+                    is_written(writes, get_storage(operand), position.at(bypassed_id), i))
+                {
+                    continue;
+                }
+                ops[id] = op;
+                alias_version++;
+                num_readers[operand->get_id()]++;
+                num_readers[bypassed_id] = 0;
+                remove(remove, bypassed);
+                auto immediate = immediates.find(id);
+                if (immediate != immediates.end())
+                {
+                    // The inlined operand may have moved to the other side
+                    auto binary_op = std::static_pointer_cast<BinaryOp>(op);
+                    immediate->second[0] = binary_op->get_lhs() == operands[immediate->second[0]] ? 0 : 1;
+                }
+                rewritten = true;
+            }
+        }
+        for (auto order : {&fw_order, &bw_order})
+        {
+            std::erase_if(*order, [&](ArrayPtr arr)
+                          { return removed.contains(arr->get_id()); });
+        }
+    }
+
+    void Graph::prune_constants(const std::unordered_set<Id> &kept)
+    {
+        std::unordered_map<Id, usize> num_readers;
+        for (auto order : {&fw_order, &bw_order})
+        {
+            for (auto &arr : *order)
+            {
+                for (auto &operand : get_operands(arr))
+                {
+                    num_readers[operand->get_id()]++;
+                }
+            }
+        }
+        // Readers come after what they read, so walking backwards drops whole chains of unread constants
+        std::unordered_set<Id> pruned;
+        for (auto order : {&bw_order, &fw_order})
+        {
+            for (auto &arr : std::views::reverse(*order))
+            {
+                auto id = arr->get_id();
+                if (!constants.contains(id) || kept.contains(id) || num_readers[id] > 0)
+                {
+                    continue;
+                }
+                pruned.insert(id);
+                for (auto &operand : get_operands(arr))
+                {
+                    num_readers[operand->get_id()]--;
+                }
+            }
+        }
+        for (auto order : {&fw_order, &bw_order})
+        {
+            std::erase_if(*order, [&](ArrayPtr arr)
+                          { return pruned.contains(arr->get_id()); });
+        }
+        num_folded = pruned.size();
+    }
+
+    void Graph::accumulate_gradients(const std::unordered_set<Id> &kept)
+    {
+        std::vector<ArrayPtr> order = fw_order;
+        order.insert(order.end(), bw_order.begin(), bw_order.end());
+        std::unordered_map<Id, usize> position;
+        std::unordered_map<Id, std::vector<ArrayPtr>> readers;
+        position.reserve(order.size());
+        readers.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            position[order[i]->get_id()] = i;
+            for (auto &operand : get_operands(order[i]))
+            {
+                readers[operand->get_id()].push_back(order[i]);
+            }
+        }
+        auto writes = get_writes(order);
+        // The in-place add or sub that is the only reader of an accumulator, nullptr if there is none
+        auto next_link = [&](ArrayPtr arr) -> ArrayPtr
+        {
+            auto iter = readers.find(arr->get_id());
+            if (iter == readers.end() || iter->second.size() != 1 || kept.contains(arr->get_id()))
+            {
+                return nullptr;
+            }
+            auto link = iter->second[0];
+            auto name = get_op(link)->get_name();
+            bool accumulates = (name == OpName::ADD || name == OpName::SUB) && is_in_place(get_op(link)) &&
+                               std::static_pointer_cast<BinaryOp>(get_op(link))->get_lhs() == arr;
+            return accumulates ? link : nullptr;
+        };
+        std::unordered_set<Id> removed;
+        for (auto &zeros : bw_order)
+        {
+            auto op = get_op(zeros);
+            if (op->get_name() != OpName::FULL || std::static_pointer_cast<FullOp>(op)->get_const() != 0 || zeros->get_buff() != nullptr)
+            {
+                continue;
+            }
+            std::vector<ArrayPtr> links;
+            for (auto link = next_link(zeros); link != nullptr; link = next_link(link))
+            {
+                links.push_back(link);
+            }
+            if (links.empty())
+            {
+                continue;
+            }
+            auto &last = links.back();
+            const usize end = position.at(last->get_id());
+            // Contributions and whether each one is subtracted, single values are read as immediates
+            std::vector<ArrayPtr> terms;
+            std::vector<bool> subtracted;
+            for (auto &link : links)
+            {
+                terms.push_back(std::static_pointer_cast<BinaryOp>(get_op(link))->get_rhs());
+                subtracted.push_back(get_op(link)->get_name() == OpName::SUB);
+            }
+            auto storage = get_storage(zeros);
+            // A single added contribution with the layout of the gradient becomes the gradient itself
+            if (links.size() == 1 && !subtracted[0] && same_layout(terms[0], last) &&
+                !is_written(writes, get_storage(terms[0]), position.at(terms[0]->get_id()), order.size()) &&
+                !is_written(writes, storage, end, order.size()))
+            {
+                auto term = duplicates.contains(terms[0]->get_id()) ? duplicates.at(terms[0]->get_id()) : terms[0];
+                ops[last->get_id()] = std::make_shared<IdentityOp>(terms[0]);
+                duplicates[last->get_id()] = term;
+                alias_version++;
+                immediates.erase(last->get_id());
+                removed.insert(zeros->get_id());
+                continue;
+            }
+            // Contributions are read when the last link runs, so their memory must not change before it
+            bool hazard = !can_fuse(last);
+            for (usize j = 0; j < links.size() && !hazard; j++)
+            {
+                hazard = !can_fuse(links[j]) ||
+                         (!immediates.contains(links[j]->get_id()) && is_written(writes, get_storage(terms[j]), position.at(links[j]->get_id()), end));
+            }
+            if (hazard)
+            {
+                continue;
+            }
+            // Every kernel sums up to max_fusion_inputs contributions, the ones after the first also read the previous sum
+            ArrayPtr sum = nullptr;
+            for (usize begin = 0; begin < links.size();)
+            {
+                Fusion fusion;
+                std::vector<std::array<isize, 3>> instrs;
+                // Registers of the inputs are negative until the number of inputs is known
+                auto input = [&](ArrayPtr arr)
+                {
+                    auto iter = std::find(fusion.inputs.begin(), fusion.inputs.end(), arr);
+                    if (iter == fusion.inputs.end())
+                    {
+                        fusion.inputs.push_back(arr);
+                        iter = std::prev(fusion.inputs.end());
+                    }
+                    return -static_cast<isize>(iter - fusion.inputs.begin()) - 1;
+                };
+                isize acc = sum != nullptr ? input(sum) : 0;
+                usize j = begin;
+                for (; j < links.size(); j++)
+                {
+                    auto immediate = immediates.find(links[j]->get_id());
+                    if (immediate == immediates.end() && fusion.inputs.size() == max_fusion_inputs &&
+                        std::find(fusion.inputs.begin(), fusion.inputs.end(), terms[j]) == fusion.inputs.end())
+                    {
+                        break;
+                    }
+                    isize term;
+                    if (immediate != immediates.end())
+                    {
+                        isize bits = immediate->second[1];
+                        instrs.push_back({static_cast<isize>(OpName::FULL), bits, bits});
+                        term = instrs.size() - 1;
+                    }
+                    else
+                    {
+                        term = input(terms[j]);
+                    }
+                    auto name = subtracted[j] ? OpName::SUB : OpName::ADD;
+                    if (sum == nullptr && j == begin)
+                    {
+                        // The first contribution is written directly instead of being added to zeros
+                        instrs.push_back({static_cast<isize>(subtracted[j] ? OpName::NEG : OpName::IDENTITY), term, term});
+                    }
+                    else
+                    {
+                        instrs.push_back({static_cast<isize>(name), acc, term});
+                    }
+                    acc = instrs.size() - 1;
+                }
+                const isize num_inputs = fusion.inputs.size();
+                for (auto &[name, lhs, rhs] : instrs)
+                {
+                    fusion.code.push_back(name);
+                    if (name == static_cast<isize>(OpName::FULL))
+                    {
+                        fusion.code.push_back(lhs);
+                        fusion.code.push_back(rhs);
+                        continue;
+                    }
+                    fusion.code.push_back(lhs < 0 ? -lhs - 1 : num_inputs + lhs);
+                    fusion.code.push_back(rhs < 0 ? -rhs - 1 : num_inputs + rhs);
+                }
+                // Links before the one holding the sum are computed inside the kernel
+                if (sum == nullptr)
+                {
+                    fusion.fused.push_back(zeros);
+                }
+                for (usize k = begin; k + 1 < j; k++)
+                {
+                    fusion.fused.push_back(links[k]);
+                }
+                auto &out = links[j - 1];
+                auto out_op = std::static_pointer_cast<BinaryOp>(get_op(out));
+                // The sum gets its own buffer instead of the memory of the zeros
+                if (subtracted[j - 1])
+                {
+                    ops[out->get_id()] = std::make_shared<SubOp>(out_op->get_lhs(), out_op->get_rhs(), false);
+                }
+                else
+                {
+                    ops[out->get_id()] = std::make_shared<AddOp>(out_op->get_lhs(), out_op->get_rhs(), false);
+                }
+                alias_version++;
+                immediates.erase(out->get_id());
+                for (auto &fused : fusion.fused)
+                {
+                    removed.insert(fused->get_id());
+                }
+                fusions[out->get_id()] = std::move(fusion);
+                sum = out;
+                begin = j;
+            }
+        }
+        std::erase_if(bw_order, [&](ArrayPtr arr)
+                      { return removed.contains(arr->get_id()); });
+    }
+
+    void Graph::fuse_elementwise(std::vector<ArrayPtr> &order, const std::unordered_map<Id, usize> &num_consumers, const std::unordered_set<Id> &kept)
+    {
+        std::unordered_map<Id, usize> position;
+        position.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            position[order[i]->get_id()] = i;
+        }
+        std::unordered_set<Id> absorbed;
+        // Consumers come after their operands, so walking backwards grows each fusion from its output
+        for (usize i = order.size(); i-- > 0;)
+        {
+            auto arr = order[i];
+            if (absorbed.contains(arr->get_id()) || fusions.contains(arr->get_id()) || duplicates.contains(arr->get_id()) || scalars.contains(arr->get_id()) ||
+                !is_elementwise(get_op(arr)) || !can_fuse(arr))
+            {
+                continue;
+            }
+            Fusion fusion;
+            // Instructions refer to inputs with negative indices until the number of inputs is known
+            std::vector<std::array<isize, 3>> instrs;
+            // Operands not emitted yet, each of them adds at most one input unless it is fused in turn
+            usize pending = 1;
+            auto add_input = [&](ArrayPtr input)
+            {
+                pending--;
+                auto iter = std::find(fusion.inputs.begin(), fusion.inputs.end(), input);
+                if (iter == fusion.inputs.end())
+                {
+                    fusion.inputs.push_back(input);
+                    iter = std::prev(fusion.inputs.end());
+                }
+                return -static_cast<isize>(iter - fusion.inputs.begin()) - 1;
+            };
+            auto emit = [&](auto &&emit, ArrayPtr node) -> isize
+            {
+                auto operands = get_op_operands(node);
+                if (node != arr)
+                {
+                    auto id = node->get_id();
+                    auto scalar = scalars.find(id);
+                    if (scalar != scalars.end())
+                    {
+                        // Single values are loaded by the kernel itself
+                        pending--;
+                        isize bits = std::bit_cast<int32_t>(scalar->second);
+                        instrs.push_back({static_cast<isize>(OpName::FULL), bits, bits});
+                        return instrs.size() - 1;
+                    }
+                    bool fusable = is_elementwise(get_op(node)) && can_fuse(node) && get_alias(node) == nullptr && !fusions.contains(id) && !kept.contains(id) &&
+                                   position.contains(id) && num_consumers.at(id) == 1 &&
+                                   fusion.inputs.size() + pending - 1 + operands.size() <= max_fusion_inputs;
+                    if (!fusable)
+                    {
+                        return add_input(node);
+                    }
+                    fusion.fused.push_back(node);
+                }
+                pending += operands.size() - 1;
+                // An in-place result writes to the buffer of its first operand, which must then stay an input
+                isize lhs = node == arr && get_alias(node) != nullptr ? add_input(operands[0]) : emit(emit, operands[0]);
+                isize rhs = operands.size() > 1 ? emit(emit, operands[1]) : lhs;
+                instrs.push_back({static_cast<isize>(get_op(node)->get_name()), lhs, rhs});
+                return instrs.size() - 1;
+            };
+            emit(emit, arr);
+            if (fusion.fused.empty())
+            {
+                continue;
+            }
+            // Fused arrays are now computed when the output is, which is wrong if an in-place array in between writes to
+            // the memory of an input
+            std::unordered_set<Id> storages;
+            for (auto &input : fusion.inputs)
+            {
+                storages.insert(get_storage(input));
+            }
+            usize first = i;
+            for (auto &node : fusion.fused)
+            {
+                first = std::min(first, position.at(node->get_id()));
+            }
+            bool hazard = false;
+            for (usize j = first + 1; j < i && !hazard; j++)
+            {
+                hazard = is_in_place(get_op(order[j])) && storages.contains(get_storage(order[j]));
+            }
+            if (hazard)
+            {
+                continue;
+            }
+            const isize num_inputs = fusion.inputs.size();
+            for (auto &[name, lhs, rhs] : instrs)
+            {
+                fusion.code.push_back(name);
+                if (name == static_cast<isize>(OpName::FULL))
+                {
+                    fusion.code.push_back(lhs);
+                    fusion.code.push_back(rhs);
+                    continue;
+                }
+                fusion.code.push_back(lhs < 0 ? -lhs - 1 : num_inputs + lhs);
+                fusion.code.push_back(rhs < 0 ? -rhs - 1 : num_inputs + rhs);
+            }
+            for (auto &node : fusion.fused)
+            {
+                absorbed.insert(node->get_id());
+            }
+            fusions[arr->get_id()] = std::move(fusion);
+        }
+        std::erase_if(order, [&](ArrayPtr arr)
+                      { return absorbed.contains(arr->get_id()); });
+    }
+
+    void Graph::place_greedy(std::vector<Storage *> planned)
+    {
+        std::ranges::stable_sort(planned, std::greater<>(), &Storage::nbytes);
+        for (usize i = 0; i < planned.size(); i++)
+        {
+            auto storage = planned[i];
+            std::vector<Storage *> live;
+            for (usize j = 0; j < i; j++)
+            {
+                if (planned[j]->first <= storage->last && storage->first <= planned[j]->last)
+                {
+                    live.push_back(planned[j]);
+                }
+            }
+            std::sort(live.begin(), live.end(), [](Storage *lhs, Storage *rhs)
+                      { return lhs->offset < rhs->offset; });
+            usize offset = 0;
+            for (auto other : live)
+            {
+                if (offset + storage->nbytes <= other->offset)
+                {
+                    break;
+                }
+                offset = std::max(offset, other->offset + other->nbytes);
+            }
+            storage->offset = offset;
+            planned_nbytes = std::max(planned_nbytes, offset + storage->nbytes);
+        }
+    }
+
+    void Graph::place_sweep(const std::vector<Storage *> &planned)
+    {
+        // Free ranges below the top of the arena by offset, and by size then offset to find the smallest that fits
+        std::map<usize, usize> gaps;
+        std::set<std::pair<usize, usize>> fits;
+        usize top = 0;
+        auto add_gap = [&](usize offset, usize nbytes)
+        {
+            gaps[offset] = nbytes;
+            fits.emplace(nbytes, offset);
+        };
+        auto remove_gap = [&](std::map<usize, usize>::iterator gap)
+        {
+            fits.erase({gap->second, gap->first});
+            gaps.erase(gap);
+        };
+        auto release = [&](Storage *storage)
+        {
+            usize offset = storage->offset;
+            usize nbytes = storage->nbytes;
+            // Merges with the free ranges right before and after
+            auto next = gaps.find(offset + nbytes);
+            if (next != gaps.end())
+            {
+                nbytes += next->second;
+                remove_gap(next);
+            }
+            auto prev = gaps.lower_bound(offset);
+            if (prev != gaps.begin() && std::prev(prev)->first + std::prev(prev)->second == offset)
+            {
+                --prev;
+                offset = prev->first;
+                nbytes += prev->second;
+                remove_gap(prev);
+            }
+            if (offset + nbytes == top)
+            {
+                top = offset;
+            }
+            else
+            {
+                add_gap(offset, nbytes);
+            }
+        };
+        // Storages in use by when each one ends
+        std::priority_queue<std::pair<usize, Storage *>, std::vector<std::pair<usize, Storage *>>, std::greater<>> live;
+        for (auto storage : planned)
+        {
+            while (!live.empty() && live.top().first < storage->first)
+            {
+                release(live.top().second);
+                live.pop();
+            }
+            auto fit = fits.lower_bound({storage->nbytes, 0});
+            if (fit != fits.end())
+            {
+                auto [nbytes, offset] = *fit;
+                remove_gap(gaps.find(offset));
+                if (nbytes > storage->nbytes)
+                {
+                    add_gap(offset + storage->nbytes, nbytes - storage->nbytes);
+                }
+                storage->offset = offset;
+            }
+            else
+            {
+                // The free range ending at the top grows instead of starting a new one above it
+                auto last = gaps.empty() ? gaps.end() : std::prev(gaps.end());
+                if (last != gaps.end() && last->first + last->second == top)
+                {
+                    top = last->first;
+                    remove_gap(last);
+                }
+                storage->offset = top;
+                top += storage->nbytes;
+            }
+            planned_nbytes = std::max(planned_nbytes, storage->offset + storage->nbytes);
+            live.emplace(storage->last, storage);
+        }
+    }
+
+    void Graph::plan_arena()
+    {
+        constexpr usize alignment = 64;
+        std::vector<ArrayPtr> order = fw_order;
+        order.insert(order.end(), bw_order.begin(), bw_order.end());
+        std::unordered_map<Id, usize> storage_idx;
+        std::vector<Storage> storages;
+        for (usize i = 0; i < order.size(); i++)
+        {
+            auto &arr = order[i];
+            for (auto &operand : get_operands(arr))
+            {
+                auto &storage = storages[storage_idx.at(operand->get_id())];
+                storage.last = i;
+                storage.uses.push_back(i);
+            }
+            auto alias = get_alias(arr);
+            if (alias != nullptr)
+            {
+                usize idx = storage_idx.at(alias->get_id());
+                storage_idx[arr->get_id()] = idx;
+                storages[idx].last = i;
+                storages[idx].uses.push_back(i);
+                continue;
+            }
+            // Inputs, constants computed once by forward, and buffers that already exist keep their own memory
+            bool pinned = arr->get_buff() != nullptr || arr->get_device() != root->get_device() || !can_plan(arr) || constants.contains(arr->get_id()) ||
+                          (i < fw_order.size() && get_op(arr)->get_type() == OpType::INITIALIZER);
+            storage_idx[arr->get_id()] = storages.size();
+            storages.push_back({arr, i, i, pinned, (arr->get_nbytes() + alignment - 1) / alignment * alignment, 0, {i}});
+        }
+        // The root and the gradients of the inputs are read after a run
+        storages[storage_idx.at(root->get_id())].pinned = true;
+        for (auto &arr : fw_order)
+        {
+            if (get_op(arr)->get_type() == OpType::INITIALIZER && arr->grad != nullptr && storage_idx.contains(arr->grad->get_id()))
+            {
+                storages[storage_idx.at(arr->grad->get_id())].pinned = true;
+            }
+        }
+
+        std::vector<Storage *> planned;
+        for (auto &storage : storages)
+        {
+            if (!storage.pinned)
+            {
+                planned.push_back(&storage);
+                naive_nbytes += storage.nbytes;
+            }
+        }
+        if (planned.size() <= max_greedy_storages)
+        {
+            place_greedy(planned);
+        }
+        else
+        {
+            place_sweep(planned);
+        }
+        if (planned_nbytes == 0)
+        {
+            return;
+        }
+        // Arrays run out of order must not write to memory before the arrays using it earlier are done with it. Each owner
+        // waits for the storages that last held its range, which waited for the ones before them.
+        if (can_schedule())
+        {
+            std::ranges::stable_sort(planned, {}, &Storage::first);
+            // Storage that last held each range of the arena, keyed by the start of the range
+            std::map<usize, std::pair<usize, Storage *>> holders;
+            auto split = [&holders](usize pos)
+            {
+                auto iter = holders.upper_bound(pos);
+                if (iter != holders.begin() && (--iter)->first < pos && pos < iter->second.first)
+                {
+                    holders.emplace(pos, iter->second);
+                    iter->second.first = pos;
+                }
+            };
+            for (auto storage : planned)
+            {
+                usize begin = storage->offset;
+                usize end = begin + storage->nbytes;
+                split(begin);
+                split(end);
+                std::vector<Storage *> previous;
+                for (auto iter = holders.lower_bound(begin); iter != holders.end() && iter->first < end; iter = holders.erase(iter))
+                {
+                    if (std::ranges::find(previous, iter->second.second) == previous.end())
+                    {
+                        previous.push_back(iter->second.second);
+                    }
+                }
+                holders.emplace(begin, std::make_pair(end, storage));
+                if (previous.empty())
+                {
+                    continue;
+                }
+                auto &waits = arena_waits[storage->owner->get_id()];
+                for (auto other : previous)
+                {
+                    for (auto use : other->uses)
+                    {
+                        waits.push_back(order[use]);
+                    }
+                }
+            }
+        }
+        for (auto storage : planned)
+        {
+            placements.emplace_back(storage->owner, storage->offset);
+        }
+        alloc_arena();
+    }
+
+    void Graph::alloc_arena()
+    {
+        arena = root->get_device().get_allocator()->alloc(planned_nbytes);
+        for (auto &[owner, offset] : placements)
+        {
+            Buffer buff(arena->get_ptr() + offset, owner->get_nbytes(), false);
+            owner->alloc(buff);
+        }
+    }
+
+    void Graph::plan_releases()
+    {
+        // Arrays sharing each storage and the position of the last array reading or writing it
+        std::unordered_map<Id, std::vector<ArrayPtr>> members;
+        std::unordered_map<Id, usize> last;
+        for (usize i = 0; i < fw_order.size(); i++)
+        {
+            auto &arr = fw_order[i];
+            for (auto &operand : get_operands(arr))
+            {
+                last[get_storage(operand)] = i;
+            }
+            auto storage = get_storage(arr);
+            last[storage] = i;
+            members[storage].push_back(arr);
+        }
+        releases.assign(fw_order.size(), {});
+        auto root_storage = get_storage(root);
+        for (auto &[storage, arrs] : members)
+        {
+            // Inputs, constants computed once and buffers that already exist keep their memory
+            auto &owner = arrs.front();
+            if (storage == root_storage || owner->get_id() != storage || get_op(owner)->get_type() == OpType::INITIALIZER ||
+                constants.contains(storage) || owner->get_buff() != nullptr)
+            {
+                continue;
+            }
+            auto &released = releases[last.at(storage)];
+            released.insert(released.end(), arrs.begin(), arrs.end());
+        }
+    }
+
+    void Graph::find_inputs()
+    {
+        for (auto &arr : fw_order)
+        {
+            auto name = get_op(arr)->get_name();
+            if (name == OpName::BUFF || name == OpName::NUMPY || name == OpName::PLACEHOLDER)
+            {
+                input_views[arr->get_id()];
+            }
+        }
+        for (auto order : {&fw_order, &bw_order})
+        {
+            for (auto &arr : *order)
+            {
+                auto views = input_views.find(get_storage(arr));
+                if (views != input_views.end() && views->first != arr->get_id())
+                {
+                    views->second.push_back(arr);
+                }
+            }
+        }
+    }
+
+    void Graph::set_input(ArrayPtr input, Buffer &buff)
+    {
+        input->dealloc();
+        input->alloc(buff);
+        // Views take the new buffer when their kernels next run
+        for (auto &view : input_views.at(input->get_id()))
+        {
+            view->dealloc();
+        }
+    }
+
+    std::string Graph::get_structure(bool plan_memory, bool fuse, bool simplify) const
+    {
+        // Operands are listed by their dense index instead of their ids, so graphs built the same way have the same
+        // structure. The flags decide which gradients are built and buffers that already exist are kept by the passes.
+        std::string structure = std::string(typeid(*this).name()) + "|" + std::to_string(plan_memory) + std::to_string(fuse) +
+                                std::to_string(simplify) + std::to_string(inference);
+        for (auto &arr : nodes)
+        {
+            structure += "\n" + get_signature(arr, get_op(arr)) + "|" + std::to_string(arr->is_constant()) + std::to_string(arr->get_requires_grad()) +
+                         std::to_string(arr->get_buff() != nullptr);
+            for (auto &operand : get_op_operands(arr))
+            {
+                structure += "|" + std::to_string(get_index(operand));
+            }
+        }
+        return structure;
+    }
+
+    std::shared_ptr<Plan> Graph::make_plan(const std::string &structure) const
+    {
+        auto plan = std::make_shared<Plan>();
+        plan->structure = structure;
+        auto index = [this](ArrayPtr arr)
+        {
+            return get_index(arr);
+        };
+        auto index_all = [&index](const std::vector<ArrayPtr> &arrs)
+        {
+            std::vector<usize> indexed;
+            indexed.reserve(arrs.size());
+            for (auto &arr : arrs)
+            {
+                indexed.push_back(index(arr));
+            }
+            return indexed;
+        };
+        plan->fw_order = index_all(fw_order);
+        plan->bw_order = index_all(bw_order);
+        // The tables are keyed by the ids of this graph, so each array looks up its own entries under its dense index
+        for (usize i = 0; i < nodes.size(); i++)
+        {
+            auto id = nodes[i]->get_id();
+            if (auto duplicate = duplicates.find(id); duplicate != duplicates.end())
+            {
+                plan->duplicates[i] = index(duplicate->second);
+            }
+            if (auto op = ops.find(id); op != ops.end())
+            {
+                plan->ops[i] = {op->second->get_name(), is_in_place(op->second), index_all(get_op_operands(nodes[i]))};
+            }
+            if (auto fusion = fusions.find(id); fusion != fusions.end())
+            {
+                plan->fusions[i] = {index_all(fusion->second.inputs), fusion->second.code, index_all(fusion->second.fused)};
+            }
+            if (constants.contains(id))
+            {
+                plan->constants.insert(i);
+            }
+            if (auto scalar = scalars.find(id); scalar != scalars.end())
+            {
+                plan->scalars[i] = scalar->second;
+            }
+            if (auto immediate = immediates.find(id); immediate != immediates.end())
+            {
+                plan->immediates[i] = immediate->second;
+            }
+            if (auto waits = arena_waits.find(id); waits != arena_waits.end())
+            {
+                plan->arena_waits[i] = index_all(waits->second);
+            }
+            if (auto views = input_views.find(id); views != input_views.end())
+            {
+                plan->input_views[i] = index_all(views->second);
+            }
+        }
+        for (auto &[owner, offset] : placements)
+        {
+            plan->placements.emplace_back(index(owner), offset);
+        }
+        for (auto &released : releases)
+        {
+            plan->releases.push_back(index_all(released));
+        }
+        plan->fw_schedule = fw_schedule;
+        plan->bw_schedule = bw_schedule;
+        plan->planned_nbytes = planned_nbytes;
+        plan->naive_nbytes = naive_nbytes;
+        plan->num_merged = num_merged;
+        plan->num_folded = num_folded;
+        plan->num_simplified = num_simplified;
+        plan->simplified_nbytes = simplified_nbytes;
+        return plan;
+    }
+
+    void Graph::apply_plan(const Plan &plan)
+    {
+        auto arrays_of = [this](const std::vector<usize> &indexed)
+        {
+            std::vector<ArrayPtr> arrs;
+            arrs.reserve(indexed.size());
+            for (auto i : indexed)
+            {
+                arrs.push_back(nodes[i]);
+            }
+            return arrs;
+        };
+        fw_order = arrays_of(plan.fw_order);
+        bw_order = arrays_of(plan.bw_order);
+        for (auto &[i, j] : plan.duplicates)
+        {
+            duplicates[nodes[i]->get_id()] = nodes[j];
+        }
+        for (auto &[i, rewrite] : plan.ops)
+        {
+            auto operands = arrays_of(rewrite.operands);
+            std::shared_ptr<Op> op;
+            switch (rewrite.name)
+            {
+            case OpName::IDENTITY:
+                op = std::make_shared<IdentityOp>(operands[0]);
+                break;
+            case OpName::ADD:
+                op = std::make_shared<AddOp>(operands[0], operands[1], rewrite.in_place);
+                break;
+            case OpName::SUB:
+                op = std::make_shared<SubOp>(operands[0], operands[1], rewrite.in_place);
+                break;
+            case OpName::DIV:
+                op = std::make_shared<DivOp>(operands[0], operands[1], rewrite.in_place);
+                break;
+            default:
+                throw std::runtime_error("Rewrite of array " + nodes[i]->get_id().str() + " cannot be taken from a plan.");
+            }
+            ops[nodes[i]->get_id()] = op;
+        }
+        for (auto &[i, fusion] : plan.fusions)
+        {
+            fusions[nodes[i]->get_id()] = {arrays_of(fusion.inputs), fusion.code, arrays_of(fusion.fused)};
+        }
+        for (auto i : plan.constants)
+        {
+            constants.insert(nodes[i]->get_id());
+        }
+        for (auto &[i, scalar] : plan.scalars)
+        {
+            scalars[nodes[i]->get_id()] = scalar;
+        }
+        for (auto &[i, immediate] : plan.immediates)
+        {
+            immediates[nodes[i]->get_id()] = immediate;
+        }
+        for (auto &[i, waits] : plan.arena_waits)
+        {
+            arena_waits[nodes[i]->get_id()] = arrays_of(waits);
+        }
+        for (auto &released : plan.releases)
+        {
+            releases.push_back(arrays_of(released));
+        }
+        for (auto &[i, views] : plan.input_views)
+        {
+            input_views[nodes[i]->get_id()] = arrays_of(views);
+        }
+        fw_schedule = plan.fw_schedule;
+        bw_schedule = plan.bw_schedule;
+        planned_nbytes = plan.planned_nbytes;
+        naive_nbytes = plan.naive_nbytes;
+        num_merged = plan.num_merged;
+        num_folded = plan.num_folded;
+        num_simplified = plan.num_simplified;
+        simplified_nbytes = plan.simplified_nbytes;
+        // The arena of this graph holds its intermediates at the offsets of the plan
+        for (auto &[i, offset] : plan.placements)
+        {
+            placements.emplace_back(nodes[i], offset);
+        }
+        if (!placements.empty())
+        {
+            alloc_arena();
+        }
+    }
+
+    Schedule Graph::plan_schedule(const std::vector<ArrayPtr> &order, const std::vector<std::vector<ArrayPtr>> &released) const
+    {
+        std::unordered_map<Id, usize> position;
+        position.reserve(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            position[order[i]->get_id()] = i;
+        }
+        // Positions of the last array writing to each storage, of the arrays reading it since and of all arrays using it
+        std::unordered_map<Id, usize> last_write;
+        std::unordered_map<Id, std::vector<usize>> reads;
+        std::unordered_map<Id, std::vector<usize>> uses;
+        std::vector<std::vector<usize>> deps(order.size());
+        auto depend = [&](usize i, ArrayPtr arr)
+        {
+            auto iter = position.find(arr->get_id());
+            if (iter != position.end())
+            {
+                deps[i].push_back(iter->second);
+            }
+        };
+        for (usize i = 0; i < order.size(); i++)
+        {
+            auto &arr = order[i];
+            for (auto &operand : get_operands(arr))
+            {
+                depend(i, operand);
+                auto storage = get_storage(operand);
+                auto write = last_write.find(storage);
+                if (write != last_write.end())
+                {
+                    deps[i].push_back(write->second);
+                }
+                reads[storage].push_back(i);
+                uses[storage].push_back(i);
+            }
+            auto alias = get_alias(arr);
+            if (alias != nullptr)
+            {
+                depend(i, alias);
+            }
+            auto storage = get_storage(arr);
+            uses[storage].push_back(i);
+            // In-place arrays and fused kernels writing into the buffer of an operand overwrite it
+            if (alias != nullptr && (is_in_place(get_op(arr)) || fusions.contains(arr->get_id())))
+            {
+                auto &readers = reads[storage];
+                deps[i].insert(deps[i].end(), readers.begin(), readers.end());
+                readers.clear();
+                auto write = last_write.find(storage);
+                if (write != last_write.end())
+                {
+                    deps[i].push_back(write->second);
+                }
+                last_write[storage] = i;
+            }
+            auto waits = arena_waits.find(arr->get_id());
+            if (waits != arena_waits.end())
+            {
+                for (auto &waited : waits->second)
+                {
+                    depend(i, waited);
+                }
+            }
+        }
+        // A buffer is freed after the last array using it, which then has to follow all the others
+        for (usize i = 0; i < released.size(); i++)
+        {
+            for (auto &arr : released[i])
+            {
+                auto &storage_uses = uses[get_storage(arr)];
+                deps[i].insert(deps[i].end(), storage_uses.begin(), storage_uses.end());
+            }
+        }
+        Schedule schedule;
+        schedule.num_deps.assign(order.size(), 0);
+        schedule.successors.resize(order.size());
+        for (usize i = 0; i < order.size(); i++)
+        {
+            std::ranges::sort(deps[i]);
+            auto [first, last] = std::ranges::unique(deps[i]);
+            deps[i].erase(first, last);
+            for (auto dep : deps[i])
+            {
+                if (dep != i)
+                {
+                    schedule.successors[dep].push_back(i);
+                    schedule.num_deps[i]++;
+                }
+            }
+        }
+        return schedule;
+    }
+
+    void Graph::execute(const std::vector<ArrayPtr> &order, const Schedule &, const std::function<void(usize)> &step)
+    {
+        for (usize i = 0; i < order.size(); i++)
+        {
+            step(i);
+        }
+    }
+
+    void Graph::call_fused(ArrayPtr, const Fusion &)
+    {
+        throw std::runtime_error("Fused kernels are not supported by this backend.");
+    }
+
+    void Graph::call(ArrayPtr arr)
+    {
+        auto duplicate = duplicates.find(arr->get_id());
+        if (duplicate != duplicates.end())
+        {
+            arr->alloc(*duplicate->second->get_buff());
+            return;
+        }
+        auto fusion = fusions.find(arr->get_id());
+        if (fusion != fusions.end())
+        {
+            call_fused(arr, fusion->second);
+            return;
+        }
+        auto op = get_op(arr);
+        switch (op->get_type())
+        {
+        case OpType::INITIALIZER:
+        {
+            if (op->get_name() == OpName::PLACEHOLDER)
+            {
+                throw std::runtime_error("Placeholder " + arr->get_id().str() + " must be bound before running the graph.");
+            }
+            call_initializer(arr);
+            break;
+        }
+        case OpType::UNARY:
+        {
+            call_unary(arr);
+            break;
+        }
+        case OpType::BINARY:
+        {
+            call_binary(arr);
+            break;
+        }
+        case OpType::MATMUL:
+        {
+            call_matmul(arr);
+            break;
+        }
+        case OpType::TRANSFORM:
+        {
+            call_transform(arr);
+            break;
+        }
+        default:
+        {
+            call_reduce(arr);
+            break;
+        }
+        }
+    }
+
+    Graph::~Graph()
+    {
+        wait();
+        if (arena != nullptr)
+        {
+            root->get_device().get_allocator()->free(arena);
+        }
+    }
+
+    usize Graph::get_num_fused() const
+    {
+        usize num_fused = 0;
+        for (auto &[id, fusion] : fusions)
+        {
+            num_fused += fusion.fused.size();
+        }
+        return num_fused;
+    }
+
+    void Graph::build_backward(std::unordered_set<Id> &kept)
+    {
+        // Arrays that get a gradient in this graph: inputs that require one and computed arrays that require one
+        // and read an operand that gets one. The flags of the arrays are left as they are, since other graphs
+        // may share them.
+        std::unordered_set<Id> with_grad;
+        for (auto &arr : fw_order)
+        {
+            auto operands = get_op_operands(arr);
+            if (arr->get_requires_grad() && (operands.empty() || std::ranges::any_of(operands, [&](ArrayPtr operand)
+                                                                                     { return with_grad.contains(operand->get_id()); })))
+            {
+                with_grad.insert(arr->get_id());
+            }
+        }
+        // Initializes root gradient
+        if (with_grad.contains(root->get_id()))
+        {
+            root->init_grad(true);
+        }
+        // Initializes the gradient arrays of the operands without allocating buffers, then adds the contributions
+        // of each array, skipping arrays without a gradient so nothing is computed for the operands that do not
+        // get one
+        std::unordered_map<Id, ArrayPtr> initial_grads;
+        for (auto &arr : std::views::reverse(fw_order))
+        {
+            // Every array reading this one came before it, so a gradient nothing added to is only read through ops
+            // without a backward, such as max, and stays null as if it had never been initialized
+            auto initial_grad = initial_grads.find(arr->get_id());
+            if (initial_grad != initial_grads.end() && arr->grad == initial_grad->second)
+            {
+                arr->grad = nullptr;
+                continue;
+            }
+            if (!with_grad.contains(arr->get_id()) || arr->grad == nullptr)
+            {
+                continue;
+            }
+            for (auto &operand : get_op_operands(arr))
+            {
+                if (with_grad.contains(operand->get_id()) && operand->grad == nullptr)
+                {
+                    operand->init_grad();
+                    initial_grads[operand->get_id()] = operand->grad;
+                }
+            }
+            arr->get_op()->backward(arr);
+        }
+        // Order the gradient arrays
+        for (auto &arr : std::views::reverse(fw_order))
+        {
+            // grad is null when backward is not implemented for op
+            if (with_grad.contains(arr->get_id()) && arr->grad_root != nullptr)
+            {
+                toposort(arr->grad_root, bw_order);
+            }
+        }
+        for (auto &arr : fw_order)
+        {
+            if (arr->grad != nullptr)
+            {
+                kept.insert(arr->grad->get_id());
+            }
+        }
+    }
+
+    void Graph::compile(bool plan_memory, bool fuse, bool simplify, bool inference, bool cache)
+    {
+        std::lock_guard<std::mutex> lock(compile_mutex);
+        if (fw_order.empty())
+        {
+            if (!inference && root->get_numel() > 1)
+            {
+                throw std::invalid_argument("Root array " + root->get_id().str() + " must contain a single element.");
+            }
+            toposort(root, fw_order);
+            this->inference = inference;
+            // The root and the gradients are read after a run
+            std::unordered_set<Id> kept = {root->get_id()};
+            if (!inference)
+            {
+                build_backward(kept);
+            }
+            // Graphs of the same structure compile to the same orders and tables over their own arrays
+            std::string structure;
+            usize hash = 0;
+            if (cache)
+            {
+                structure = get_structure(plan_memory, fuse, simplify);
+                hash = std::hash<std::string>()(structure);
+                auto plan = get_plan_cache().find(hash, structure);
+                if (plan != nullptr)
+                {
+                    apply_plan(*plan);
+                    return;
+                }
+            }
+            merge_duplicates();
+            fold_constants();
+            if (simplify)
+            {
+                rewrite_algebraic(kept);
+            }
+            accumulate_gradients(kept);
+            if (fuse)
+            {
+                std::unordered_map<Id, usize> num_consumers;
+                for (auto order : {&fw_order, &bw_order})
+                {
+                    for (auto &arr : *order)
+                    {
+                        for (auto &operand : get_operands(arr))
+                        {
+                            num_consumers[operand->get_id()]++;
+                        }
+                    }
+                }
+                fuse_elementwise(fw_order, num_consumers, kept);
+                fuse_elementwise(bw_order, num_consumers, kept);
+            }
+            prune_constants(kept);
+            if (plan_memory)
+            {
+                plan_arena();
+            }
+            else if (inference)
+            {
+                plan_releases();
+            }
+            find_inputs();
+            if (can_schedule())
+            {
+                fw_schedule = plan_schedule(fw_order, releases);
+                bw_schedule = plan_schedule(bw_order, {});
+            }
+            if (cache)
+            {
+                get_plan_cache().insert(hash, make_plan(structure));
+            }
+        }
+    }
+
+    std::vector<Id> Graph::get_used() const
+    {
+        std::vector<Id> ids;
+        auto add = [&ids](const std::vector<ArrayPtr> &order)
+        {
+            for (auto &arr : order)
+            {
+                ids.push_back(arr->get_id());
+            }
+        };
+        add(fw_order);
+        // The gradients of the leaves are arrays of the backward order
+        add(bw_order);
+        return ids;
+    }
+
+    void Graph::launch(std::function<void()> run)
+    {
+        std::thread(std::move(run)).detach();
+    }
+
+    std::shared_future<void> Graph::start(bool backward, bool wait)
+    {
+        auto run = std::make_shared<Run>();
+        auto future = run->future;
+        // Each future reports only the error of its own run. The graph is not touched once the run has reported, so it may
+        // be destroyed after waiting for it.
+        auto body = [this, run, backward]()
+        {
+            try
+            {
+                backward ? run_backward() : run_forward();
+                run->done.set_value();
+            }
+            catch (...)
+            {
+                run->done.set_exception(std::current_exception());
+            }
+            for (auto &next : get_runs().finish(*run))
+            {
+                std::exchange(next->launch, nullptr)();
+            }
+        };
+        if (!wait)
+        {
+            run->launch = [this, body]()
+            { launch(body); };
+        }
+        auto deps = get_runs().add(get_used(), run);
+        if (wait)
+        {
+            for (auto &dep : deps)
+            {
+                dep.wait();
+            }
+            body();
+            future.get();
+            return future;
+        }
+        pending = future;
+        // Runs waiting for others are started by the last of them to finish
+        if (deps.empty())
+        {
+            std::exchange(run->launch, nullptr)();
+        }
+        return future;
+    }
+
+    std::shared_future<void> Graph::forward_async()
+    {
+        return start(false, false);
+    }
+
+    std::shared_future<void> Graph::backward_async()
+    {
+        return start(true, false);
+    }
+
+    void Graph::wait()
+    {
+        if (pending.valid())
+        {
+            pending.wait();
+        }
+    }
+
+    void Graph::forward()
+    {
+        start(false, true);
+    }
+
+    void Graph::run_forward()
+    {
+        if (fw_order.empty())
+        {
+            throw GraphNotCompiledException();
+        }
+        execute(fw_order, fw_schedule, [this](usize i)
+                {
+            auto &arr = fw_order[i];
+            bool once = get_op(arr)->get_type() == OpType::INITIALIZER || constants.contains(arr->get_id());
+            if (!once || arr->get_buff() == nullptr)
+            {
+                // Call initializers and constants only once
+                call(arr);
+            }
+            if (!releases.empty())
+            {
+                for (auto &released : releases[i])
+                {
+                    released->dealloc();
+                }
+            } });
+    }
+
+    void Graph::backward()
+    {
+        start(true, true);
+    }
+
+    void Graph::run_backward()
+    {
+        // The backward order is empty when no input requires a gradient
+        if (fw_order.empty())
+        {
+            throw GraphNotCompiledException();
+        }
+        if (inference)
+        {
+            throw std::runtime_error("Graph was compiled for inference and has no backward pass.");
+        }
+        execute(bw_order, bw_schedule, [this](usize i)
+                {
+            auto &arr = bw_order[i];
+            if (!constants.contains(arr->get_id()) || arr->get_buff() == nullptr)
+            {
+                call(arr);
+            } });
+    }
+
+    void Graph::bind(ArrayPtr input, ArrayPtr arr)
+    {
+        if (fw_order.empty())
+        {
+            throw GraphNotCompiledException();
+        }
+        // Runs started without waiting still read the buffers that binding frees
+        wait();
+        if (!input_views.contains(input->get_id()))
+        {
+            throw std::invalid_argument("Array " + input->get_id().str() + " is not an input of the graph.");
+        }
+        // The kernels and rewrites were chosen for the layout of the input
+        if (!same_layout(input, arr))
+        {
+            throw std::invalid_argument("Array " + arr->get_id().str() + " cannot be bound to input " + input->get_id().str() + " of dtype " +
+                                        input->get_dtype().str() + ", view " + vnumstr(input->get_view()) + " and stride " + vnumstr(input->get_stride()) + ".");
+        }
+        if (arr->get_buff() == nullptr)
+        {
+            throw std::invalid_argument("Array " + arr->get_id().str() + " has no buffer to bind.");
+        }
+        set_input(input, *arr->get_buff());
+    }
+
+    void Graph::run(const std::vector<std::pair<ArrayPtr, ArrayPtr>> &inputs)
+    {
+        for (auto &[input, arr] : inputs)
+        {
+            bind(input, arr);
+        }
+        forward();
+    }
+
+    const std::string Graph::str() const
+    {
+        if (fw_order.empty())
+        {
+            throw GraphNotCompiledException();
+        }
+        std::string s = "Forward:\n";
+        auto line = [this](ArrayPtr arr)
+        {
+            auto s = arr->get_id().str() + ": " + get_op(arr)->str();
+            auto duplicate = duplicates.find(arr->get_id());
+            if (duplicate != duplicates.end())
+            {
+                s += ", same as: " + duplicate->second->get_id().str();
+            }
+            auto immediate = immediates.find(arr->get_id());
+            if (immediate != immediates.end())
+            {
+                s += ", immediate: " + std::to_string(std::bit_cast<float>(static_cast<int32_t>(immediate->second[1])));
+            }
+            auto fusion = fusions.find(arr->get_id());
+            if (fusion != fusions.end())
+            {
+                s += ", fused: " + vstr<ArrayPtr>(fusion->second.fused, [this](ArrayPtr fused)
+                                                  { return fused->get_id().str() + " " + get_op(fused)->get_name_str(); });
+            }
+            return s + "\n";
+        };
+        for (auto &arr : fw_order)
+        {
+            s += line(arr);
+        }
+        s += "Backward:\n";
+        for (auto &arr : bw_order)
+        {
+            s += line(arr);
+        }
+        if (num_simplified > 0)
+        {
+            s += "Simplified: " + std::to_string(num_simplified) + " arrays, " + std::to_string(simplified_nbytes) + " bytes\n";
+        }
+        if (arena != nullptr)
+        {
+            s += "Memory: " + std::to_string(planned_nbytes) + " bytes planned, " + std::to_string(naive_nbytes) + " bytes without planning\n";
+        }
+        return s;
+    }
+}
\ No newline at end of file
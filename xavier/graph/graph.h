@@ -1,15 +1,240 @@
 #pragma once
 
+#include <future>
 #include "../core/array.h"
 
 namespace xv::graph
 {
     using namespace xv::core;
 
+    // Elementwise subgraph computed by one kernel. Registers are the inputs followed by one per instruction, each
+    // instruction is an (op, lhs, rhs) triple over earlier registers and the last one is the output.
+    struct Fusion
+    {
+        std::vector<ArrayPtr> inputs;
+        std::vector<isize> code;
+        // Arrays computed inside the kernel without a buffer of their own
+        std::vector<ArrayPtr> fused;
+    };
+
+    // Dependencies between the arrays of an order by position, the number of arrays each one waits for and the arrays
+    // waiting for each one
+    struct Schedule
+    {
+        std::vector<usize> num_deps;
+        std::vector<std::vector<usize>> successors;
+    };
+
+    struct Plan;
+
     class Graph : public IStr
     {
     protected:
         ArrayPtr root;
+        // Arrays reached by toposort, in the order they were first reached. Each array keeps its position as its dense index.
+        std::vector<ArrayPtr> nodes;
+        std::vector<ArrayPtr> fw_order;
+        std::vector<ArrayPtr> bw_order;
+        // Single buffer holding every planned intermediate, along with its size and the bytes of one buffer per intermediate
+        std::shared_ptr<Buffer> arena = nullptr;
+        // Array allocating each planned storage and its offset in the arena
+        std::vector<std::pair<ArrayPtr, usize>> placements;
+        usize planned_nbytes = 0;
+        usize naive_nbytes = 0;
+        // Fusions keyed by the array that writes their output
+        std::unordered_map<Id, Fusion> fusions;
+        // Arrays that compute the same value as an earlier array and share its buffer instead
+        std::unordered_map<Id, ArrayPtr> duplicates;
+        // Ops that rewrites compute arrays with instead of their own, which the arrays keep for other graphs
+        std::unordered_map<Id, std::shared_ptr<Op>> ops;
+        usize num_merged = 0;
+        // Arrays computed only from full and arange, which run once, and the value of those holding a single float
+        std::unordered_set<Id> constants;
+        std::unordered_map<Id, float> scalars;
+        // Kernel parameters of binary arrays reading a single-valued operand as an immediate: its index and its bits
+        std::unordered_map<Id, std::vector<isize>> immediates;
+        usize num_folded = 0;
+        // Arrays whose kernels the algebraic rewrites removed and the bytes they no longer allocate
+        usize num_simplified = 0;
+        usize simplified_nbytes = 0;
+        // Graphs compiled for inference have no backward order and free each intermediate after its last reader, the
+        // arrays released after each position of the forward order
+        bool inference = false;
+        std::vector<std::vector<ArrayPtr>> releases;
+        // Backends running independent arrays at the same time follow these, where each arena owner also waits for the
+        // arrays that used its memory before it
+        Schedule fw_schedule;
+        Schedule bw_schedule;
+        std::unordered_map<Id, std::vector<ArrayPtr>> arena_waits;
+        // Arrays of both orders sharing the buffer of each input, which binding new data to the input points them away from
+        std::unordered_map<Id, std::vector<ArrayPtr>> input_views;
+        // Last run of the graph started without waiting for it
+        std::shared_future<void> pending;
+
+        // Storage found for each array along with the alias version it was found at. Passes that change aliases bump the
+        // version, which makes the storages found before it stale.
+        mutable std::unordered_map<Id, std::pair<Id, usize>> storages;
+        usize alias_version = 0;
+
+        // Builds the gradient arrays and the backward order, adding the gradients to the arrays kept after a run
+        void build_backward(std::unordered_set<Id> &kept);
+
+        // Appends the arrays leading to an array that are not ordered yet, each after its operands. Walks an explicit stack,
+        // so chains of any depth fit.
+        void toposort(ArrayPtr arr, std::vector<ArrayPtr> &order);
+
+        // Gives an array the next dense index unless this graph reached it already, and tells whether it was new
+        bool reach(ArrayPtr arr);
+
+        // Dense index of an array reached by toposort
+        usize get_index(ArrayPtr arr) const;
+
+        // Arrays read by the kernel of an array, the inputs of its fusion if it has one
+        std::vector<ArrayPtr> get_operands(ArrayPtr arr) const;
+
+        // Op computing an array in this graph, which is its own op unless a rewrite replaced it
+        std::shared_ptr<Op> get_op(ArrayPtr arr) const;
+
+        // Operands of the op of an array
+        std::vector<ArrayPtr> get_op_operands(ArrayPtr arr) const;
+
+        // Appends the operands of the op computing an array, without allocating a vector per array
+        void append_op_operands(ArrayPtr arr, std::vector<ArrayPtr> &operands) const;
+
+        // Operand whose buffer the array shares instead of allocating its own, nullptr if it allocates
+        ArrayPtr get_alias(ArrayPtr arr) const;
+
+        // Array that allocates the buffer an array ends up in, remembered for every array on the way to it so that long
+        // chains of in-place arrays and views are walked once
+        Id get_storage(ArrayPtr arr) const;
+
+        // Positions of the in-place arrays writing to each buffer over an order, in increasing order
+        std::unordered_map<Id, std::vector<usize>> get_writes(const std::vector<ArrayPtr> &order) const;
+
+        // Turns arrays with the same op, operands and attributes as an earlier array into views of it, unless an in-place
+        // array could make their values differ
+        void merge_duplicates();
+
+        // Whether the output of an array can be placed in the arena and hold stale data before its kernel runs
+        virtual bool can_plan(ArrayPtr) { return true; }
+
+        // Backends walk the inputs of a fused kernel with a fixed-size indexer
+        static constexpr usize max_fusion_inputs = 8;
+
+        // Whether a backend can pass a single-valued operand of a binary array to its kernel as an immediate
+        virtual bool can_inline(ArrayPtr) { return false; }
+
+        // Finds the constants, evaluates the single-valued ones and picks the operands passed as immediates
+        void fold_constants();
+
+        // Turns arrays equal to one of their operands, such as identity copies, double negations and transforms that undo
+        // each other, into views of it and replaces recip and neg operands with div and sub, dropping what is left unread
+        void rewrite_algebraic(const std::unordered_set<Id> &kept);
+
+        // Replaces each chain of in-place adds into a zero-filled gradient with the only contribution when it has the same
+        // layout, or with kernels that write the sum of the contributions directly
+        void accumulate_gradients(const std::unordered_set<Id> &kept);
+
+        // Drops constants that no kernel reads, so they never get a buffer
+        void prune_constants(const std::unordered_set<Id> &kept);
+
+        // Whether a backend can compute an elementwise array inside a fused kernel
+        virtual bool can_fuse(ArrayPtr) { return false; }
+
+        // Merges chains of elementwise arrays, each with a single consumer, into the kernel of that consumer
+        void fuse_elementwise(std::vector<ArrayPtr> &order, const std::unordered_map<Id, usize> &num_consumers, const std::unordered_set<Id> &kept);
+
+        // Schedules freeing the buffer of each intermediate right after the last array of the forward order reading it
+        void plan_releases();
+
+        // Buffer shared by an array and its views and in-place results, over the forward then backward order
+        struct Storage
+        {
+            // Array that allocates the buffer, the others in the storage are views or in-place results of it
+            ArrayPtr owner;
+            usize first;
+            usize last;
+            bool pinned;
+            usize nbytes;
+            usize offset = 0;
+            // Positions of the arrays reading or writing the buffer
+            std::vector<usize> uses = {};
+        };
+
+        // Placing the largest storages first compares each one with all placed before it, larger plans are swept instead
+        static constexpr usize max_greedy_storages = 1 << 12;
+
+        // Places the largest storages first, each at the lowest offset that is free for its whole lifetime
+        void place_greedy(std::vector<Storage *> planned);
+
+        // Places storages in the order they are first used, each in the smallest free range left by the storages no longer
+        // used, or at the top of the arena
+        void place_sweep(const std::vector<Storage *> &planned);
+
+        // Assigns arena offsets to intermediates whose lifetimes over the forward then backward order do not overlap
+        void plan_arena();
+
+        // Allocates the arena and places the planned storages in it
+        void alloc_arena();
+
+        // Whether a backend can run arrays of an order that do not depend on each other at the same time
+        virtual bool can_schedule() { return false; }
+
+        // Orders each array after the arrays it reads, the last write to the buffers it reads and, if it writes to a
+        // buffer, the arrays reading it before. The last array using a released buffer follows all the others.
+        Schedule plan_schedule(const std::vector<ArrayPtr> &order, const std::vector<std::vector<ArrayPtr>> &released) const;
+
+        // Runs step on each position of an order, one after another unless a backend runs them along a schedule
+        virtual void execute(const std::vector<ArrayPtr> &order, const Schedule &schedule, const std::function<void(usize)> &step);
+
+        // Finds the inputs that can be bound to new data and the arrays viewing their buffers
+        void find_inputs();
+
+        // Points an input at a buffer and the arrays viewing it away from the old one
+        void set_input(ArrayPtr input, Buffer &buff);
+
+        // Ops, layouts, flags and operands of the arrays by dense index, along with the backend and the compile options,
+        // which decide what compiling does
+        std::string get_structure(bool plan_memory, bool fuse, bool simplify) const;
+
+        // Compiled orders and tables with the arrays replaced by their dense index
+        std::shared_ptr<Plan> make_plan(const std::string &structure) const;
+
+        // Fills the orders and tables from a plan made by a graph of the same structure and allocates an arena of its own
+        void apply_plan(const Plan &plan);
+
+        // Ids of the arrays of both orders, which runs read or write
+        std::vector<Id> get_used() const;
+
+        // Runs the kernels of an order without waiting for the runs started before
+        void run_forward();
+
+        void run_backward();
+
+        // Runs a run started without waiting once the runs before it are done, without blocking the caller. Backends without
+        // a worker pool give each run a thread of its own.
+        virtual void launch(std::function<void()> run);
+
+        // Starts a run on the calling thread after the runs started before that use the same arrays, or launches it once
+        // they are done without waiting for it
+        std::shared_future<void> start(bool backward, bool wait);
+
+        void call(ArrayPtr arr);
+
+        // Each backend runs the kernels for an array through the methods below
+        virtual void call_initializer(ArrayPtr arr) = 0;
+
+        virtual void call_unary(ArrayPtr arr) = 0;
+
+        virtual void call_binary(ArrayPtr arr) = 0;
+
+        virtual void call_matmul(ArrayPtr arr) = 0;
+
+        virtual void call_transform(ArrayPtr arr) = 0;
+
+        virtual void call_reduce(ArrayPtr arr) = 0;
+
+        virtual void call_fused(ArrayPtr arr, const Fusion &fusion);
 
     public:
         Graph(ArrayPtr root) : root(root) {}
@@ -18,12 +243,56 @@ namespace xv::graph
 
         Graph &operator=(const Graph &) = delete;
 
+        virtual ~Graph();
+
         ArrayPtr get_root() { return root; }
 
-        virtual void compile() = 0;
+        usize get_planned_nbytes() const { return planned_nbytes; }
+
+        usize get_naive_nbytes() const { return naive_nbytes; }
+
+        usize get_num_fused() const;
+
+        usize get_num_merged() const { return num_merged; }
+
+        usize get_num_folded() const { return num_folded; }
+
+        usize get_num_simplified() const { return num_simplified; }
+
+        usize get_simplified_nbytes() const { return simplified_nbytes; }
+
+        // With plan_memory, intermediates share one arena and only the root, the inputs and their gradients keep their
+        // values after a run. Backward must then follow a forward. With fuse, elementwise arrays read only by the next
+        // elementwise array are computed inside its kernel and never get a buffer. Constants that kernels only read as
+        // immediates are never allocated either. With simplify, algebraic rewrites drop arrays that become unread. With
+        // inference, no gradient is built, the root may hold any number of elements and only the root keeps its value.
+        // With cache, the orders and tables of a graph with the same structure compiled before are reused, see PlanCache.
+        virtual void compile(bool plan_memory = false, bool fuse = false, bool simplify = false, bool inference = false, bool cache = false);
+
+        // Both wait for the runs started before that use the arrays of the graph, from any thread. Graphs can run from
+        // several threads at once, but each graph from one thread at a time.
+        virtual void forward();
+
+        virtual void backward();
+
+        // Return at once with a future that is ready when the run has finished and rethrows its error. Runs of graphs that
+        // share arrays, including the gradients, follow the order they were started in, and arrays of a graph must not be
+        // read or changed from outside until its run has finished.
+        std::shared_future<void> forward_async();
+
+        std::shared_future<void> backward_async();
+
+        // Waits for the last run started by this graph without waiting
+        void wait();
+
+        // Points an input of the compiled graph to the buffer of an array with the same layout, without copying. The
+        // orders, memory plan and kernel choices stay as they are, and the next run reads the new data. Waits for the runs
+        // of the graph started without waiting first.
+        void bind(ArrayPtr input, ArrayPtr arr);
 
-        virtual void forward() = 0;
+        // Binds each input to its array and runs forward
+        void run(const std::vector<std::pair<ArrayPtr, ArrayPtr>> &inputs);
 
-        virtual void backward() = 0;
+        const std::string str() const override;
     };
 }
\ No newline at end of file
@@ -5,7 +5,7 @@ namespace xv::graph
     void MTLGraph::call_initializer(ArrayPtr arr)
     {
         arr->alloc();
-        auto op = arr->get_op();
+        auto op = get_op(arr);
         switch (op->get_name())
         {
         case OpName::FULL:
@@ -27,7 +27,7 @@ namespace xv::graph
 
     void MTLGraph::call_unary(ArrayPtr arr)
     {
-        auto unary_op = std::static_pointer_cast<UnaryOp>(arr->get_op());
+        auto unary_op = std::static_pointer_cast<UnaryOp>(get_op(arr));
         auto operand = unary_op->get_operand();
         if (unary_op->is_in_place())
         {
@@ -42,7 +42,7 @@ namespace xv::graph
 
     void MTLGraph::call_binary(ArrayPtr arr)
     {
-        auto binary_op = std::static_pointer_cast<BinaryOp>(arr->get_op());
+        auto binary_op = std::static_pointer_cast<BinaryOp>(get_op(arr));
         auto lhs = binary_op->get_lhs();
         auto rhs = binary_op->get_rhs();
         if (binary_op->is_in_place())
@@ -59,7 +59,7 @@ namespace xv::graph
 
     void MTLGraph::call_matmul(ArrayPtr arr)
     {
-        auto matmul_op = std::static_pointer_cast<MatmulOp>(arr->get_op());
+        auto matmul_op = std::static_pointer_cast<MatmulOp>(get_op(arr));
         auto lhs = matmul_op->get_lhs();
         auto rhs = matmul_op->get_rhs();
         arr->alloc();
@@ -68,7 +68,7 @@ namespace xv::graph
 
     void MTLGraph::call_transform(ArrayPtr arr)
     {
-        auto op = arr->get_op();
+        auto op = get_op(arr);
         switch (op->get_name())
         {
         case OpName::RESHAPE:
@@ -115,195 +115,24 @@ namespace xv::graph
 
     void MTLGraph::call_reduce(ArrayPtr arr)
     {
-        auto op = arr->get_op();
+        auto op = get_op(arr);
         auto reduce_op = std::static_pointer_cast<ReduceOp>(op);
         auto operand = reduce_op->get_operand();
         arr->alloc();
-        if (reduce_op->get_dims().size() == 0)
+        auto &dims = reduce_op->get_dims();
+        if (dims.size() == 0 || dims.size() == operand->get_ndim())
         {
             // Reduce to one item
             reduce_all(reduce_op->get_name_str(), operand, arr, ctx);
         }
-        else
+        else if (operand->get_ndim() == 2 && dims[0] == 1)
         {
-            // Reduce multiple dimensions
+            // Reduce each row of a matrix
             reduce_col(reduce_op->get_name_str(), operand, arr, ctx);
         }
-    }
-
-    void MTLGraph::toposort(ArrayPtr arr, std::vector<ArrayPtr> &order)
-    {
-        if (visited.contains(arr->get_id()))
-        {
-            return;
-        }
-        visited.insert(arr->get_id());
-        auto op = arr->get_op();
-        switch (op->get_type())
-        {
-        case OpType::INITIALIZER:
-        {
-            order.push_back(arr);
-            break;
-        }
-        case OpType::UNARY:
-        {
-            auto unary_op = std::static_pointer_cast<UnaryOp>(arr->get_op());
-            auto operand = unary_op->get_operand();
-            toposort(operand, order);
-            order.push_back(arr);
-            break;
-        }
-        case OpType::BINARY:
-        {
-            auto binary_op = std::static_pointer_cast<BinaryOp>(arr->get_op());
-            auto lhs = binary_op->get_lhs();
-            auto rhs = binary_op->get_rhs();
-            toposort(lhs, order);
-            toposort(rhs, order);
-            order.push_back(arr);
-            break;
-        }
-        case OpType::MATMUL:
-        {
-            auto matmul_op = std::static_pointer_cast<MatmulOp>(arr->get_op());
-            auto lhs = matmul_op->get_lhs();
-            auto rhs = matmul_op->get_rhs();
-            toposort(lhs, order);
-            toposort(rhs, order);
-            order.push_back(arr);
-            break;
-        }
-        case OpType::TRANSFORM:
-        {
-            auto transform_op = std::static_pointer_cast<TransformOp>(arr->get_op());
-            auto operand = transform_op->get_operand();
-            toposort(operand, order);
-            order.push_back(arr);
-            break;
-        }
-        default:
-        {
-            // Reduce operation
-            auto reduce_op = std::static_pointer_cast<ReduceOp>(arr->get_op());
-            auto operand = reduce_op->get_operand();
-            toposort(operand, order);
-            order.push_back(arr);
-            break;
-        }
-        }
-    }
-
-    void MTLGraph::call(ArrayPtr arr)
-    {
-        auto op = arr->get_op();
-        switch (op->get_type())
-        {
-        case OpType::INITIALIZER:
-        {
-            call_initializer(arr);
-            break;
-        }
-        case OpType::UNARY:
-        {
-            call_unary(arr);
-            break;
-        }
-        case OpType::BINARY:
-        {
-            call_binary(arr);
-            break;
-        }
-        case OpType::MATMUL:
-        {
-            call_matmul(arr);
-            break;
-        }
-        case OpType::TRANSFORM:
-        {
-            call_transform(arr);
-            break;
-        }
-        default:
-        {
-            call_reduce(arr);
-            break;
-        }
-        }
-    }
-
-    void MTLGraph::compile()
-    {
-        if (fw_order.empty())
-        {
-            if (root->get_numel() > 1)
-            {
-                throw std::invalid_argument("Root array " + root->get_id().str() + " must contain a single element.");
-            }
-            toposort(root, fw_order);
-            // Initializes root gradient
-            root->init_grad(true);
-            // Initializes the gradient array first without allocating buffers
-            for (auto &arr : std::views::reverse(fw_order))
-            {
-                arr->get_op()->backward(arr);
-            }
-            // Order the gradient arrays
-            for (auto &arr : std::views::reverse(fw_order))
-            {
-                // grad is null when backward is not implemented for op
-                if (arr->grad_root != nullptr)
-                {
-                    toposort(arr->grad_root, bw_order);
-                }
-            }
-        }
-    }
-
-    void MTLGraph::forward()
-    {
-        if (fw_order.empty())
-        {
-            throw MTLGraphNotCompiledException();
-        }
-        for (auto &arr : fw_order)
-        {
-            if (arr->get_op()->get_type() != OpType::INITIALIZER || (arr->get_op()->get_type() == OpType::INITIALIZER && arr->get_buff() == nullptr))
-            {
-                // Call initializers only once
-                call(arr);
-            }
-        }
-    }
-
-    void MTLGraph::backward()
-    {
-        if (bw_order.empty())
-        {
-            throw MTLGraphNotCompiledException();
-        }
-        for (auto &arr : bw_order)
-        {
-            call(arr);
-        }
-    }
-
-    const std::string MTLGraph::str() const
-    {
-        if (fw_order.empty())
-        {
-            throw MTLGraphNotCompiledException();
-        }
-        std::string s = "Forward:\n";
-        for (auto &arr : fw_order)
-        {
-            s += arr->get_id().str() + ": " + arr->get_op()->str() + "\n";
-        }
-        s += "Backward:\n";
-        for (auto &arr : bw_order)
+        else
         {
-            s += arr->get_id().str() + ": " + arr->get_op()->str() + "\n";
+            throw std::invalid_argument("Metal backend only reduces all dimensions or the last dimension of a matrix.");
         }
-        return s;
     }
 }
\ No newline at end of file
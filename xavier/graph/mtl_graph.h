@@ -15,35 +15,27 @@ namespace xv::graph
     {
     private:
         std::shared_ptr<MTLContext> ctx;
-        std::unordered_set<Id> visited;
-        std::vector<ArrayPtr> fw_order;
-        std::vector<ArrayPtr> bw_order;
 
-        void toposort(ArrayPtr arr, std::vector<ArrayPtr> &order);
+    protected:
+        void call_initializer(ArrayPtr arr) override;
 
-        void call(ArrayPtr arr);
+        void call_unary(ArrayPtr arr) override;
 
-        void call_initializer(ArrayPtr arr);
+        void call_binary(ArrayPtr arr) override;
 
-        void call_unary(ArrayPtr arr);
+        void call_matmul(ArrayPtr arr) override;
 
-        void call_binary(ArrayPtr arr);
+        void call_transform(ArrayPtr arr) override;
 
-        void call_matmul(ArrayPtr arr);
+        void call_reduce(ArrayPtr arr) override;
 
-        void call_transform(ArrayPtr arr);
-
-        void call_reduce(ArrayPtr arr);
+        // Reduction kernels accumulate atomically into a zeroed output, which an arena shared with other arrays cannot provide
+        bool can_plan(ArrayPtr arr) override { return get_op(arr)->get_type() != OpType::REDUCE; }
 
     public:
         MTLGraph(ArrayPtr root, std::shared_ptr<MTLContext> ctx) : Graph(root), ctx(ctx) {}
 
-        void compile() override;
-
-        void forward() override;
-
-        void backward() override;
-
-        const std::string str() const override;
+        // A run started without waiting calls the kernels of this class
+        ~MTLGraph() override { wait(); }
     };
 }
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "plan_cache.h"
+
+namespace xv::graph
+{
+    void PlanCache::evict()
+    {
+        while (plans.size() > capacity)
+        {
+            index.erase(plans.back().first);
+            plans.pop_back();
+        }
+    }
+
+    std::shared_ptr<Plan> PlanCache::find(usize hash, const std::string &structure)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = index.find(hash);
+        // Structures colliding on the hash are misses
+        if (iter == index.end() || iter->second->second->structure != structure)
+        {
+            misses++;
+            return nullptr;
+        }
+        hits++;
+        plans.splice(plans.begin(), plans, iter->second);
+        return plans.front().second;
+    }
+
+    void PlanCache::insert(usize hash, std::shared_ptr<Plan> plan)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = index.find(hash);
+        if (iter != index.end())
+        {
+            plans.erase(iter->second);
+        }
+        plans.emplace_front(hash, plan);
+        index[hash] = plans.begin();
+        evict();
+    }
+
+    void PlanCache::set_capacity(usize capacity)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->capacity = capacity;
+        evict();
+    }
+
+    void PlanCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        plans.clear();
+        index.clear();
+        hits = 0;
+        misses = 0;
+    }
+
+    usize PlanCache::get_capacity()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return capacity;
+    }
+
+    usize PlanCache::get_size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return plans.size();
+    }
+
+    usize PlanCache::get_hits()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hits;
+    }
+
+    usize PlanCache::get_misses()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return misses;
+    }
+
+    PlanCache &get_plan_cache()
+    {
+        static PlanCache cache;
+        return cache;
+    }
+}
\ No newline at end of file
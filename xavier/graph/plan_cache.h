@@ -0,0 +1,92 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include "graph.h"
+
+namespace xv::graph
+{
+    // Compiled orders and tables of a graph with each array replaced by its dense index, which graphs of the same
+    // structure give to the same arrays. Graphs taking a plan keep their own arrays, gradients and arena.
+    struct Plan
+    {
+        // Rewritten op of an array, rewrites only make identities, adds, subs and divs
+        struct Rewrite
+        {
+            OpName name;
+            bool in_place;
+            std::vector<usize> operands;
+        };
+
+        struct PlannedFusion
+        {
+            std::vector<usize> inputs;
+            std::vector<isize> code;
+            std::vector<usize> fused;
+        };
+
+        std::string structure;
+        std::vector<usize> fw_order;
+        std::vector<usize> bw_order;
+        std::unordered_map<usize, usize> duplicates;
+        std::unordered_map<usize, Rewrite> ops;
+        std::unordered_map<usize, PlannedFusion> fusions;
+        std::unordered_set<usize> constants;
+        std::unordered_map<usize, float> scalars;
+        std::unordered_map<usize, std::vector<isize>> immediates;
+        std::vector<std::pair<usize, usize>> placements;
+        std::unordered_map<usize, std::vector<usize>> arena_waits;
+        std::vector<std::vector<usize>> releases;
+        std::unordered_map<usize, std::vector<usize>> input_views;
+        Schedule fw_schedule;
+        Schedule bw_schedule;
+        usize planned_nbytes = 0;
+        usize naive_nbytes = 0;
+        usize num_merged = 0;
+        usize num_folded = 0;
+        usize num_simplified = 0;
+        usize simplified_nbytes = 0;
+    };
+
+    // Process-wide cache of compiled graphs keyed by a hash of their structure, evicting the least recently used
+    class PlanCache
+    {
+    private:
+        usize capacity = 64;
+        usize hits = 0;
+        usize misses = 0;
+        // Most recently used first
+        std::list<std::pair<usize, std::shared_ptr<Plan>>> plans;
+        std::unordered_map<usize, std::list<std::pair<usize, std::shared_ptr<Plan>>>::iterator> index;
+        std::mutex mutex;
+
+        void evict();
+
+    public:
+        PlanCache() = default;
+
+        PlanCache(const PlanCache &) = delete;
+
+        PlanCache &operator=(const PlanCache &) = delete;
+
+        // Returns the plan compiled for a structure and counts a hit, or counts a miss and returns nullptr
+        std::shared_ptr<Plan> find(usize hash, const std::string &structure);
+
+        void insert(usize hash, std::shared_ptr<Plan> plan);
+
+        void set_capacity(usize capacity);
+
+        // Drops every plan and resets the counters, graphs already running a plan keep it
+        void clear();
+
+        usize get_capacity();
+
+        usize get_size();
+
+        usize get_hits();
+
+        usize get_misses();
+    };
+
+    PlanCache &get_plan_cache();
+}
\ No newline at end of file
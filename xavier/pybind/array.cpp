@@ -69,7 +69,7 @@ namespace xv::bind
 		std::vector<xc::usize> dims;
 		for (auto &dim : py_dims)
 		{
-			dims.push_back(dim.cast<xc::usize>());
+			dims.push_back(map_idx(operand->get_ndim(), dim.cast<xc::isize>()));
 		}
 		return f(operand, dims);
 	}
@@ -274,27 +274,39 @@ namespace xv::bind
 		return flatten(obj_to_arr(operand, xc::device0), start_dim, end_dim);
 	}
 
-	inline xc::ArrayPtr sum(xc::ArrayPtr operand, const std::vector<py::int_> &dims)
+	inline xc::ArrayPtr sum(xc::ArrayPtr operand, const std::vector<py::int_> &dims, bool keepdim)
 	{
-		return reduce(operand, dims, [](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
-					  { return arr->sum(dims); });
+		return reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+					  { return arr->sum(dims, keepdim); });
 	}
 
-	inline xc::ArrayPtr m_sum(const py::object &operand, const std::vector<py::int_> &dims)
+	inline xc::ArrayPtr m_sum(const py::object &operand, const std::vector<py::int_> &dims, bool keepdim)
 	{
-		return m_reduce(operand, dims, [](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
-						{ return arr->sum(dims); });
+		return m_reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+						{ return arr->sum(dims, keepdim); });
 	}
 
-	inline xc::ArrayPtr max(xc::ArrayPtr operand, const std::vector<py::int_> &dims)
+	inline xc::ArrayPtr max(xc::ArrayPtr operand, const std::vector<py::int_> &dims, bool keepdim)
 	{
-		return reduce(operand, dims, [](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
-					  { return arr->max(dims); });
+		return reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+					  { return arr->max(dims, keepdim); });
 	}
 
-	inline xc::ArrayPtr m_max(const py::object &operand, const std::vector<py::int_> &dims)
+	inline xc::ArrayPtr m_max(const py::object &operand, const std::vector<py::int_> &dims, bool keepdim)
 	{
-		return m_reduce(operand, dims, [](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
-						{ return arr->max(dims); });
+		return m_reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+						{ return arr->max(dims, keepdim); });
+	}
+
+	inline xc::ArrayPtr min(xc::ArrayPtr operand, const std::vector<py::int_> &dims, bool keepdim)
+	{
+		return reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+					  { return arr->min(dims, keepdim); });
+	}
+
+	inline xc::ArrayPtr m_min(const py::object &operand, const std::vector<py::int_> &dims, bool keepdim)
+	{
+		return m_reduce(operand, dims, [keepdim](xc::ArrayPtr arr, const std::vector<xc::usize> &dims)
+						{ return arr->min(dims, keepdim); });
 	}
 }
\ No newline at end of file
@@ -65,10 +65,17 @@ void init_xv_module(py::module_ &m)
     py::class_<xc::Device>(m, "Device")
         .def("type", &xc::Device::get_type)
         .def("idx", &xc::Device::get_idx)
+        .def("memory_allocated", [](const xc::Device &device)
+             { return device.get_allocator()->get_allocated(); }, "Returns the bytes held by live buffers on the device.")
+        .def("memory_reserved", [](const xc::Device &device)
+             { return device.get_allocator()->get_reserved(); }, "Returns the bytes held by the device allocator, including cached blocks.")
+        .def("empty_cache", [](const xc::Device &device)
+             { device.get_allocator()->empty_cache(); }, "Releases cached blocks of the device allocator.")
         .def("__eq__", &xc::Device::operator==)
         .def("__neq__", &xc::Device::operator!=);
 
     m.attr("device0") = &xc::device0;
+    m.attr("cpu0") = &xc::cpu0;
 
     py::class_<xc::Array, xc::ArrayPtr>(m, "Array", py::buffer_protocol())
         .def(py::init<const xc::Shape &, const xc::Dtype &, const xc::Device &>(), "shape"_a, "dtype"_a = xc::f32, "device"_a = xc::device0)
@@ -82,6 +89,8 @@ void init_xv_module(py::module_ &m)
         .def("dtype", &xc::Array::get_dtype, "Returns the data type of the array.")
         .def("device", &xc::Array::get_device, "Returns the device that the array is allocated on.")
         .def_readonly("grad", &xc::Array::grad, "Accesses the gradient of the array.")
+        .def("requires_grad", &xc::Array::get_requires_grad, "Checks if the gradient of the array is computed.")
+        .def("set_requires_grad", &xc::Array::set_requires_grad, "Sets whether the gradient of the array is computed, and through it those of its operands.", "requires_grad"_a)
         .def("ptr", [](const xc::Array &arr)
              { return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(arr.get_ptr())); }, "Returns a pointer to the data of the array.")
         .def("strided_idx", &xc::Array::strided_idx, "Accesses the kth element in the array.", "k"_a)
@@ -118,6 +127,9 @@ void init_xv_module(py::module_ &m)
         .def("__itruediv__", &xb::self_div, "rhs"_a)
         .def("__matmul__", &xb::matmul, "rhs"_a)
         .def("__eq__", &xb::eq, "rhs"_a)
+        // Hashes by id so arrays can key the inputs of Graph.run
+        .def("__hash__", [](const xc::Array &arr)
+             { return std::hash<xc::Id>()(arr.get_id()); })
         .def("__ne__", &xb::neq, "rhs"_a)
         .def("__gt__", &xb::gt, "rhs"_a)
         .def("__ge__", &xb::geq, "rhs"_a)
@@ -134,21 +146,55 @@ void init_xv_module(py::module_ &m)
         .def("permute", &xb::permute, "Permutes the dimensions of the array according to the given order.", "order"_a)
         .def("T", &xb::T, "Transposes the array.", "start_dim"_a = 0, "end_dim"_a = -1)
         .def("flatten", &xb::flatten, "Flattens the array.", "start_dim"_a = 0, "end_dim"_a = -1)
-        .def("sum", &xb::sum, "Computes the sum of the array elements in given dimensions.", "dims"_a = std::vector<py::int_>())
-        .def("max", &xb::max, "Computes the maximum of the array elements in given dimensions.", "dims"_a = std::vector<py::int_>())
+        .def("sum", &xb::sum, "Computes the sum of the array elements in given dimensions.", "dims"_a = std::vector<py::int_>(), "keepdim"_a = true)
+        .def("max", &xb::max, "Computes the maximum of the array elements in given dimensions.", "dims"_a = std::vector<py::int_>(), "keepdim"_a = true)
+        .def("min", &xb::min, "Computes the minimum of the array elements in given dimensions.", "dims"_a = std::vector<py::int_>(), "keepdim"_a = true)
         .def_static("from_buffer", &xb::array_from_buffer, "Creates a 1D array from buffer without copying.", "buff"_a, "device"_a = xc::device0, "constant"_a = false)
         .def_static("from_numpy", &xb::array_from_numpy, "Creates an array from numpy array without copying.", "np_arr"_a, "device"_a = xc::device0, "constant"_a = false)
+        .def_static("placeholder", &xc::Array::placeholder, "Creates an input without data that a compiled graph binds to new data on each run.", "view"_a, "dtype"_a = xc::f32, "device"_a = xc::device0)
         .def("numpy", &xb::array_to_numpy, "Converts the array to a numpy array.");
 
-    py::class_<xg::Graph, std::unique_ptr<xg::Graph, py::nodelete>>(m, "Graph")
+    py::class_<std::shared_future<void>>(m, "Future")
+        .def("wait", [](const std::shared_future<void> &future)
+             { future.get(); }, "Blocks until the run has finished and raises its error if it failed.", py::call_guard<py::gil_scoped_release>())
+        .def("done", [](const std::shared_future<void> &future)
+             { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }, "Returns whether the run has finished.");
+
+    py::class_<xg::Graph, std::unique_ptr<xg::Graph, py::nodelete>>(m, "Graph", py::dynamic_attr())
         .def("root", &xg::Graph::get_root)
         .def("__str__", &xg::Graph::str)
-        .def("compile", &xg::Graph::compile)
-        .def("forward", &xg::Graph::forward)
-        .def("backward", &xg::Graph::backward);
+        .def("compile", &xg::Graph::compile, "Builds the forward and backward orders, optionally fusing elementwise chains, simplifying algebraic patterns and placing intermediates in one arena. With inference, only the forward order is built. With cache, the plan of a graph of the same structure compiled before is reused.", "plan_memory"_a = false, "fuse"_a = false, "simplify"_a = false, "inference"_a = false, "cache"_a = false, py::call_guard<py::gil_scoped_release>())
+        .def("planned_nbytes", &xg::Graph::get_planned_nbytes, "Returns the arena size of the memory plan.")
+        .def("naive_nbytes", &xg::Graph::get_naive_nbytes, "Returns the bytes the planned intermediates would take with a buffer each.")
+        .def("num_fused", &xg::Graph::get_num_fused, "Returns the number of arrays computed inside fused kernels.")
+        .def("num_merged", &xg::Graph::get_num_merged, "Returns the number of arrays that reuse the result of an identical earlier array.")
+        .def("num_folded", &xg::Graph::get_num_folded, "Returns the number of constant arrays read only as immediates and never allocated.")
+        .def("num_simplified", &xg::Graph::get_num_simplified, "Returns the number of kernels removed by algebraic simplification.")
+        .def("simplified_nbytes", &xg::Graph::get_simplified_nbytes, "Returns the bytes no longer allocated after algebraic simplification.")
+        .def("forward", &xg::Graph::forward, py::call_guard<py::gil_scoped_release>())
+        .def("backward", &xg::Graph::backward, py::call_guard<py::gil_scoped_release>())
+        .def("forward_async", &xg::Graph::forward_async, "Starts forward and returns a Future without waiting. Runs of graphs sharing arrays follow the order they were started in.", py::call_guard<py::gil_scoped_release>())
+        .def("backward_async", &xg::Graph::backward_async, "Starts backward and returns a Future without waiting. Runs of graphs sharing arrays follow the order they were started in.", py::call_guard<py::gil_scoped_release>())
+        .def("wait", &xg::Graph::wait, "Blocks until the last run started by the graph has finished.", py::call_guard<py::gil_scoped_release>())
+        .def("run", &xb::graph_run, "Binds the inputs to new data without copying or recompiling and runs forward.", "inputs"_a);
+
+    py::class_<xg::CPUGraph, xg::Graph, std::unique_ptr<xg::CPUGraph>>(m, "CPUGraph", py::dynamic_attr())
+        .def(py::init<xc::ArrayPtr, std::shared_ptr<xcpu::CPUContext>>(), "root"_a, "ctx"_a);
+    py::class_<xcpu::CPUContext, std::shared_ptr<xcpu::CPUContext>>(m, "CPUContext")
+        .def(py::init<>());
+    m.def("set_num_workers", &xcpu::set_num_workers, "Sets the number of CPU worker threads. Runs already started finish on the old workers.", "num_workers"_a, py::call_guard<py::gil_scoped_release>());
+    m.def("get_num_workers", &xcpu::get_num_workers, "Returns the number of CPU worker threads.");
+    m.def("get_plan_cache_hits", []
+          { return xg::get_plan_cache().get_hits(); }, "Returns the number of compilations that reused a cached plan.");
+    m.def("get_plan_cache_misses", []
+          { return xg::get_plan_cache().get_misses(); }, "Returns the number of compilations that found no cached plan.");
+    m.def("set_plan_cache_capacity", [](xc::usize capacity)
+          { xg::get_plan_cache().set_capacity(capacity); }, "Sets the number of plans the cache keeps.", "capacity"_a);
+    m.def("clear_plan_cache", []
+          { xg::get_plan_cache().clear(); }, "Drops every cached plan and resets the counters.");
 
 #ifdef __APPLE__
-    py::class_<xg::MTLGraph, xg::Graph, std::unique_ptr<xg::MTLGraph>>(m, "MTLGraph")
+    py::class_<xg::MTLGraph, xg::Graph, std::unique_ptr<xg::MTLGraph>>(m, "MTLGraph", py::dynamic_attr())
         .def(py::init<xc::ArrayPtr, std::shared_ptr<xm::MTLContext>>(), "root"_a, "ctx"_a);
     py::class_<xm::MTLContext, std::shared_ptr<xm::MTLContext>>(m, "MTLContext")
         .def(py::init<const std::string &>(), "lib_path"_a);
@@ -179,6 +225,7 @@ void init_xv_module(py::module_ &m)
     m.def("permute", &xb::m_permute, "Permutes the dimensions of the array according to the given order.", "arr"_a, "order"_a);
     m.def("T", &xb::m_T, "Transposes the array.", "arr"_a, "start_dim"_a = 0, "end_dim"_a = -1);
     m.def("flatten", &xb::m_flatten, "Flattens the array.", "arr"_a, "start_dim"_a = 0, "end_dim"_a = -1);
-    m.def("sum", &xb::m_sum, "Computes the sum of the array elements in given dimensions.", "arr"_a, "dims"_a = std::vector<py::int_>());
-    m.def("max", &xb::m_max, "Computes the maximum of the array elements in given dimensions.", "arr"_a, "dims"_a = std::vector<py::int_>());
+    m.def("sum", &xb::m_sum, "Computes the sum of the array elements in given dimensions.", "arr"_a, "dims"_a = std::vector<py::int_>(), "keepdim"_a = true);
+    m.def("max", &xb::m_max, "Computes the maximum of the array elements in given dimensions.", "arr"_a, "dims"_a = std::vector<py::int_>(), "keepdim"_a = true);
+    m.def("min", &xb::m_min, "Computes the minimum of the array elements in given dimensions.", "arr"_a, "dims"_a = std::vector<py::int_>(), "keepdim"_a = true);
 }
\ No newline at end of file
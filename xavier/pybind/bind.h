@@ -4,6 +4,9 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 #include "../core/iter.h"
+#include "../graph/cpu_graph.h"
+#include "../graph/plan_cache.h"
+#include "../backend/cpu/thread_pool.h"
 #ifdef __APPLE__
 #include "../graph/mtl_graph.h"
 #endif
@@ -11,7 +14,10 @@
 namespace py = pybind11;
 namespace xc = xv::core;
 namespace xg = xv::graph;
+namespace xcpu = xv::backend::cpu;
+#ifdef __APPLE__
 namespace xm = xv::backend::metal;
+#endif
 using namespace pybind11::literals;
 
 void init_xv_module(py::module_ &);
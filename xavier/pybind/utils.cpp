@@ -101,6 +101,37 @@ namespace xv::bind
 				));
 	}
 
+	void graph_run(py::object graph, const py::dict &inputs)
+	{
+		auto &g = graph.cast<xg::Graph &>();
+		// Objects whose memory the inputs point to, keyed by the id of the input
+		if (!py::hasattr(graph, "_bound"))
+		{
+			graph.attr("_bound") = py::dict();
+		}
+		auto bound = graph.attr("_bound").cast<py::dict>();
+		for (auto [key, value] : inputs)
+		{
+			auto input = key.cast<xc::ArrayPtr>();
+			if (py::isinstance<xc::Array>(value))
+			{
+				g.bind(input, value.cast<xc::ArrayPtr>());
+				bound[py::int_(input->get_id().get_data())] = value;
+				continue;
+			}
+			// Contiguous inputs such as placeholders take any numpy array, copied only when it is not contiguous
+			auto np_arr = input->is_contiguous() ? py::array::ensure(value, py::array::c_style) : py::array::ensure(value);
+			if (!np_arr)
+			{
+				throw xc::PybindInvalidArgumentType(get_pyclass(py::reinterpret_borrow<py::object>(value)), "Array, numpy.ndarray");
+			}
+			g.bind(input, array_from_numpy(np_arr, input->get_device(), false));
+			bound[py::int_(input->get_id().get_data())] = np_arr;
+		}
+		py::gil_scoped_release release;
+		g.forward();
+	}
+
 	std::vector<xc::Range> get_arr_ranges(const xc::Array &arr, const py::object &obj)
 	{
 		std::vector<xc::Range> ranges;
@@ -14,6 +14,10 @@ namespace xv::bind
 
 	py::array array_to_numpy(xc::Array &arr);
 
+	// Binds each input placeholder of a compiled graph to an array or a numpy array without copying and runs forward. The
+	// graph keeps each bound object alive until its input is bound again. The GIL is released while forward runs.
+	void graph_run(py::object graph, const py::dict &inputs);
+
 	std::vector<xc::Range> get_arr_ranges(const xc::Array &arr, const py::object &obj);
 
 	xc::usize map_idx(xc::usize len, xc::isize idx);